@@ -358,8 +358,10 @@ public:
     }
     
     
+    //string_view (C++17) takes std::string, string literals and substrings
+    //without copying the key into a new std::string on every call
     /** Inserts a word into the trie. */
-    void insert(string word) {
+    void insert(string_view word) {
         int len = word.size();
         TrieNode* node = root;
         int i = 0;
@@ -381,7 +383,7 @@ public:
     }
     
     /** Returns if the word is in the trie. */
-    bool search(string word) {
+    bool search(string_view word) {
         TrieNode* node = root;
         int len = word.size();
         for(int i = 0; i < len; i++){
@@ -395,7 +397,7 @@ public:
     }
     
     /** Returns if there is any word in the trie that starts with the given prefix. */
-    bool startsWith(string prefix) {
+    bool startsWith(string_view prefix) {
         TrieNode* node = root;
         int len = prefix.size();
         for(int i = 0; i < len; i++){
@@ -595,7 +597,7 @@ int dist [SIZE];
 bool vis [SIZE];
 
 void dijkstra(){
-    memset(dist, INT_MAX, sizeof(dist));                                            // set the vertices distances as infinity
+    fill(dist, dist + SIZE, INT_MAX);           // set the vertices distances as infinity (not memset, it works byte by byte, see section 24)
     memset(vis, false , sizeof(vis));            // set all vertex as unvisited
     dist[1] = 0;
     multiset < pair < int , int > > s;          // multiset do the job as a min-priority queue
@@ -679,17 +681,23 @@ in case |E| = |V|^2 , O(|E|^3) .
    }
 
     dis[0] = 0;
-    for(int i = 0; i < n - 1; i++){
-        int j = 0;
-        while(v[j].size() != 0){
-
-            if(dis[ v[j][0]  ] + v[j][2] < dis[ v[j][1] ] ){
+    bool changed = true;
+    for(int i = 0; i < n - 1 && changed; i++){          // stop early once nothing changes
+        changed = false;
+        for(int j = 0; j < m; j++){
+            if(dis[ v[j][0] ] != 2e9 && dis[ v[j][0]  ] + v[j][2] < dis[ v[j][1] ] ){
                 dis[ v[j][1] ] = dis[ v[j][0]  ] + v[j][2];
+                changed = true;
             }
-            j++;
         }
     }
 
+    // One more round: if a distance still decreases there is a negative cycle
+    bool negativeCycle = false;
+    for(int j = 0; j < m && changed; j++)
+        if(dis[ v[j][0] ] != 2e9 && dis[ v[j][0] ] + v[j][2] < dis[ v[j][1] ])
+            negativeCycle = true;
+
 
 
 //14. Floyd–Warshall's Algorithm
@@ -720,12 +728,15 @@ path will be a concatenation of the shortest path from i to K, then from K to j.
 
 Time Complexity of Floyd–Warshall's Algorithm is O(|V|^3).
 */
-//path[i][j] record the shortest path between i and j
+//path[i][j] record the shortest path between i and j (the vertex before j)
+//Only update it when going through k is shorter, otherwise it points to k's path
 for(int k = 1; k <= n; k++){
     for(int i = 1; i <= n; i++){
         for(int j = 1; j <= n; j++){
-            dist[i][j] = min( dist[i][j], dist[i][k] + dist[k][j] );
-            path[i][j] = path[k][j];
+            if(dist[i][k] + dist[k][j] < dist[i][j]){
+                dist[i][j] = dist[i][k] + dist[k][j];
+                path[i][j] = path[k][j];
+            }
         }
     }
 }
@@ -1525,18 +1536,22 @@ void Union(subset subsets[], int x, int y)
 
 // Compare two edges according to their weights. 
 // Used in qsort() for sorting an array of edges 
+// qsort() needs negative/zero/positive, returning "a > b" (0 or 1) never 
+// says "less" and leaves the order unreliable. 
 int myComp(const void* a, const void* b) 
 { 
 	Edge* a1 = (Edge*)a; 
 	Edge* b1 = (Edge*)b; 
-	return a1->weight > b1->weight; 
+	return (a1->weight > b1->weight) - (a1->weight < b1->weight); 
 } 
 
 // The main function to construct MST using Kruskal's algorithm 
 void KruskalMST(Graph* graph) 
 { 
 	int V = graph->V; 
-	Edge result[V]; // Tnis will store the resultant MST 
+	// Tnis will store the resultant MST. Not a VLA (Edge result[V]), that is 
+	// not standard C++ and overflows the stack for large graphs. 
+	vector<Edge> result(V); 
 	int e = 0; // An index variable, used for result[] 
 	int i = 0; // An index variable, used for sorted edges 
 
@@ -2133,4 +2148,6614 @@ xu = -1 * unsigned(x); //xu will be 234 now
 //which stores the merged array in result
 merge(l1.begin(), l1.end(), l2.begin(), l2.end(), result.begin()); 
 //where array [begin, middle) is merged with array [middle, end).
-inplace_merge(l.begin(), l.middle, l.end()) 
\ No newline at end of file
+inplace_merge(l.begin(), l.middle, l.end()) 
+
+
+//*********************************************************************
+//26. Fenwick tree with O(n) construction, range operations and lower_bound
+/*
+The Binary Indexed Tree in section 15 is built by calling updateBIT() for 
+every element, which is O(nLogn), and constructBITree() hands back a raw 
+new int[n+1] which nobody deletes. The int sums also overflow quickly for 
+frequency tables. The class below keeps the same 1-based layout (m_tree[0] 
+is the dummy node) but owns its storage and accumulates in a 64-bit type.
+
+O(n) construction:
+Copy arr[0..n-1] into tree[1..n], then walk i = 1..n once and add tree[i] 
+into its parent j = i + (i & -i). When we reach i, every child of i has a 
+smaller index and was already pushed into it, so tree[i] is complete before 
+it is pushed up. Each node is touched once, so the build is O(n).
+
+Range update / range query (the two trees trick):
+Keep two trees B1 and B2. Adding v to arr[l..r] becomes
+    B1.add(l, v),     B1.add(r+1, -v)
+    B2.add(l, v*l),   B2.add(r+1, -v*(r+1))
+and the prefix sum of arr[0..x] is B1.prefixSum(x) * (x+1) - B2.prefixSum(x).
+For l <= x <= r this gives v*(x+1) - v*l = v*(x-l+1), and for x > r the two
+terms cancel to v*(r-l+1), which is exactly what we added.
+
+lower_bound(target):
+Returns the smallest index i such that arr[0] + ... + arr[i] >= target. It 
+needs all elements to be non-negative, so the prefix sums are monotone. 
+Instead of binary searching over prefixSum() (O(Log^2 n)) we descend the 
+implicit tree: start at pos = 0 with the largest power of two step, and if 
+tree[pos + step] < target we move to pos + step and subtract it. Every step 
+halves, so it is O(Logn). If arr[] is a frequency table (like freq[] in 
+section 15), lower_bound(k) is the k-th smallest value (k-th order statistic).
+
+2D variant:
+The 2D tree is the 1D tree applied on rows and then on columns, so update and
+query are O(LogN * LogM). The O(NM) construction is the same trick: push every
+cell into its column parent within the row, then into its row parent.
+*/
+#include <vector>
+#include <iostream>
+using namespace std;
+
+// T is the accumulator type. Keep the default 64-bit type unless you know 
+// the sums fit into something smaller.
+template<typename T = long long>
+class FenwickTree{
+private:
+    // m_tree[0] is the dummy node, m_tree[1..m_len] is the BITree
+    vector<T> m_tree;
+    int m_len;
+    // Largest power of two <= m_len, the first step of lower_bound()
+    int m_highBit;
+
+    void build(){
+        for(int i = 1; i <= m_len; ++i){
+            int parent = i + (i & -i);
+            if(parent <= m_len)
+                m_tree[parent] += m_tree[i];
+        }
+        m_highBit = 1;
+        while((m_highBit << 1) <= m_len)
+            m_highBit <<= 1;
+    }
+public:
+    explicit FenwickTree(int n = 0): m_tree(n + 1, T()), m_len(n){
+        build();
+    }
+
+    // Builds the tree from arr[first, last) in O(n)
+    template<typename It>
+    FenwickTree(It first, It last): m_tree(1, T()){
+        m_tree.insert(m_tree.end(), first, last);
+        m_len = static_cast<int>(m_tree.size()) - 1;
+        build();
+    }
+
+    int size() const { return m_len; }
+
+    // arr[index] += delta
+    void add(int index, T delta){
+        for(++index; index <= m_len; index += index & (-index))
+            m_tree[index] += delta;
+    }
+
+    // Returns sum of arr[0..index], 0 when index < 0
+    T prefixSum(int index) const{
+        T sum = T();
+        for(++index; index > 0; index -= index & (-index))
+            sum += m_tree[index];
+        return sum;
+    }
+
+    // Returns sum of arr[l..r]
+    T rangeSum(int l, int r) const{
+        return prefixSum(r) - prefixSum(l - 1);
+    }
+
+    // Smallest index i with prefixSum(i) >= target, or size() if the total
+    // is smaller than target. All elements must be non-negative.
+    int lower_bound(T target) const{
+        int pos = 0;
+        for(int step = m_highBit; step > 0; step >>= 1){
+            if(pos + step <= m_len && m_tree[pos + step] < target){
+                pos += step;
+                target -= m_tree[pos];
+            }
+        }
+        // pos is the 1-based index of the last prefix < target
+        return pos;
+    }
+};
+
+// Range update and range query with two FenwickTree. All operations O(Logn).
+template<typename T = long long>
+class RangeFenwickTree{
+private:
+    FenwickTree<T> m_b1;
+    FenwickTree<T> m_b2;
+
+    T prefixSum(int x) const{
+        return m_b1.prefixSum(x) * T(x + 1) - m_b2.prefixSum(x);
+    }
+public:
+    explicit RangeFenwickTree(int n = 0): m_b1(n), m_b2(n){}
+
+    // With B1 all zero, prefixSum(x) is -B2.prefixSum(x), so we only need to
+    // build B2 from -arr[] (still O(n)).
+    template<typename It>
+    RangeFenwickTree(It first, It last): m_b1(static_cast<int>(distance(first, last))){
+        vector<T> neg;
+        neg.reserve(m_b1.size());
+        for(; first != last; ++first)
+            neg.push_back(-T(*first));
+        m_b2 = FenwickTree<T>(neg.begin(), neg.end());
+    }
+
+    int size() const { return m_b1.size(); }
+
+    // arr[l..r] += v
+    void rangeAdd(int l, int r, T v){
+        m_b1.add(l, v);
+        m_b2.add(l, v * T(l));
+        if(r + 1 < size()){
+            m_b1.add(r + 1, -v);
+            m_b2.add(r + 1, -v * T(r + 1));
+        }
+    }
+
+    // Returns sum of arr[l..r]
+    T rangeSum(int l, int r) const{
+        return prefixSum(r) - (l > 0 ? prefixSum(l - 1) : T());
+    }
+};
+
+// 2D Fenwick tree over a rows x cols grid, stored in one contiguous array
+template<typename T = long long>
+class FenwickTree2D{
+private:
+    int m_rows, m_cols;
+    // (m_rows+1) x (m_cols+1), row 0 and column 0 are dummy
+    vector<T> m_tree;
+
+    T& at(int r, int c) { return m_tree[r * (m_cols + 1) + c]; }
+    const T& at(int r, int c) const { return m_tree[r * (m_cols + 1) + c]; }
+public:
+    FenwickTree2D(int rows, int cols): m_rows(rows), m_cols(cols), 
+        m_tree((rows + 1) * (cols + 1), T()){}
+
+    // grid is row-major with rows * cols elements, built in O(rows * cols)
+    template<typename U>
+    FenwickTree2D(const vector<U>& grid, int rows, int cols): FenwickTree2D(rows, cols){
+        for(int r = 1; r <= m_rows; ++r)
+            for(int c = 1; c <= m_cols; ++c)
+                at(r, c) = T(grid[(r - 1) * m_cols + (c - 1)]);
+        // 1D build inside every row
+        for(int r = 1; r <= m_rows; ++r)
+            for(int c = 1; c <= m_cols; ++c){
+                int parent = c + (c & -c);
+                if(parent <= m_cols)
+                    at(r, parent) += at(r, c);
+            }
+        // then across rows, a whole row at a time
+        for(int r = 1; r <= m_rows; ++r){
+            int parent = r + (r & -r);
+            if(parent <= m_rows)
+                for(int c = 1; c <= m_cols; ++c)
+                    at(parent, c) += at(r, c);
+        }
+    }
+
+    // grid[row][col] += delta
+    void add(int row, int col, T delta){
+        for(int r = row + 1; r <= m_rows; r += r & (-r))
+            for(int c = col + 1; c <= m_cols; c += c & (-c))
+                at(r, c) += delta;
+    }
+
+    // Returns sum of grid[0..row][0..col]
+    T prefixSum(int row, int col) const{
+        T sum = T();
+        for(int r = row + 1; r > 0; r -= r & (-r))
+            for(int c = col + 1; c > 0; c -= c & (-c))
+                sum += at(r, c);
+        return sum;
+    }
+
+    // Returns sum of the rectangle grid[r1..r2][c1..c2]
+    T rangeSum(int r1, int c1, int r2, int c2) const{
+        return prefixSum(r2, c2) - prefixSum(r1 - 1, c2) 
+             - prefixSum(r2, c1 - 1) + prefixSum(r1 - 1, c1 - 1);
+    }
+};
+
+// Driver program to test above classes
+int main()
+{
+    int freq[] = {2, 1, 1, 3, 2, 3, 4, 5, 6, 7, 8, 9};
+    int n = sizeof(freq)/sizeof(freq[0]);
+    FenwickTree<> bit(freq, freq + n);
+    cout << "Sum of elements in arr[0..5] is " << bit.prefixSum(5) << endl;
+
+    freq[3] += 6;
+    bit.add(3, 6);
+    cout << "Sum of elements in arr[0..5] after update is "
+         << bit.prefixSum(5) << endl;
+
+    // freq[v] is how many times value v shows up, so the 10th smallest
+    // value is the first v whose prefix count reaches 10
+    cout << "10th smallest value is " << bit.lower_bound(10) << endl;
+
+    RangeFenwickTree<> rbit(freq, freq + n);
+    rbit.rangeAdd(2, 7, 10);
+    cout << "Sum of arr[0..5] after adding 10 to arr[2..7] is "
+         << rbit.rangeSum(0, 5) << endl;
+
+    vector<int> grid = {1, 2, 3,
+                        4, 5, 6,
+                        7, 8, 9};
+    FenwickTree2D<> bit2d(grid, 3, 3);
+    bit2d.add(1, 1, 100);
+    cout << "Sum of grid[1..2][1..2] is " << bit2d.rangeSum(1, 1, 2, 2) << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//27. Concurrent Fenwick tree for counters updated from many threads
+/*
+updateBIT() in section 15 does plain "BITree[index] += val" along the update 
+path, so two threads updating freq[] at the same time lose updates. Putting a
+mutex around it serializes every writer. Instead we make every node an 
+atomic and let writers do a relaxed fetch_add on each node of the path.
+
+Why relaxed fetch_add is enough for the tree itself:
+Additions commute, so the final value of every node is correct no matter how 
+the writers interleave. We only need the read-modify-write to be atomic.
+
+What a reader can see (two kinds of reads):
+1) prefixSumWeak(x): relaxed loads along the query path. The query path of x 
+splits [0..x] into disjoint ranges and an update of arr[i] with i <= x lands 
+in exactly one of them, so every single add() is either fully counted or not 
+counted at all. But the set of counted adds is not a consistent cut: if 
+thread A adds before thread B, the read may count B and not A. Good enough 
+for monitoring counters, and it never blocks anybody.
+2) prefixSum(x): linearizable. The reader raises a "frozen" flag and waits 
+until no writer is inside add(), then reads the path and lowers the flag. 
+Writers announce themselves on a stripe counter (its own cache line). 
+Stripes are handed out round-robin, one per thread on its first add(), so 
+with up to 64 writer threads no two share a stripe and writers never touch 
+a shared counter. More threads than stripes wrap around and share, which is 
+still correct, only slower. The cost is that add() is not lock-free: while 
+a linearizable read runs, writers wait for it, for O(Logn) loads.
+
+Per-thread buffered mode:
+With 32 writers, the nodes near the top (indices that are powers of two) are
+on almost every update path and their cache lines bounce between cores. A 
+Buffer collects a thread's adds locally, already pushed along the update 
+path into a private node array, and flush() does a single fetch_add per 
+dirty node. k buffered updates that share the top nodes cost one atomic 
+per node instead of k. Buffered deltas are invisible to readers until the 
+buffer is flushed (every batchSize adds, on flush() and in the destructor).
+*/
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <iostream>
+using namespace std;
+
+class ConcurrentFenwickTree{
+private:
+    // 1-based like section 15, m_tree[0] is the dummy node
+    vector<atomic<long long>> m_tree;
+    int m_len;
+
+    // A writer stripe sits on its own cache line so writers do not share
+    // the counter they use to announce themselves
+    struct alignas(64) WriterStripe{
+        atomic<int> active{0};
+    };
+    static const int kStripes = 64;
+    WriterStripe m_stripes[kStripes];
+    atomic<bool> m_frozen{false};
+    mutex m_snapshotMutex;
+
+    // Round-robin instead of hashing the thread id: 32 hashed ids in 64 
+    // buckets almost surely collide (birthday paradox)
+    static int stripeOfThisThread(){
+        static atomic<unsigned> nextStripe{0};
+        static thread_local const int stripe = 
+            static_cast<int>(nextStripe.fetch_add(1, memory_order_relaxed) % kStripes);
+        return stripe;
+    }
+
+    // The seq_cst fetch_add/load pair here and the seq_cst store/load pair 
+    // in freeze() guarantee that either the reader sees the writer or the 
+    // writer sees the frozen flag.
+    WriterStripe& enterWrite(){
+        WriterStripe& s = m_stripes[stripeOfThisThread()];
+        for(;;){
+            s.active.fetch_add(1);
+            if(!m_frozen.load())
+                return s;
+            s.active.fetch_sub(1);
+            while(m_frozen.load(memory_order_relaxed))
+                this_thread::yield();
+        }
+    }
+    void exitWrite(WriterStripe& s){
+        s.active.fetch_sub(1, memory_order_release);
+    }
+
+    void freeze(){
+        m_snapshotMutex.lock();
+        m_frozen.store(true);
+        for(auto& s : m_stripes)
+            while(s.active.load() != 0)
+                this_thread::yield();
+    }
+    void unfreeze(){
+        m_frozen.store(false);
+        m_snapshotMutex.unlock();
+    }
+
+    long long readPath(int index) const{
+        long long sum = 0;
+        for(++index; index > 0; index -= index & (-index))
+            sum += m_tree[index].load(memory_order_relaxed);
+        return sum;
+    }
+public:
+    explicit ConcurrentFenwickTree(int n): m_tree(n + 1), m_len(n){
+        for(auto& node : m_tree)
+            node.store(0, memory_order_relaxed);
+    }
+
+    int size() const { return m_len; }
+
+    // arr[index] += delta. Blocks while a linearizable read (prefixSum or
+    // rangeSum) holds the tree frozen, otherwise never waits.
+    void add(int index, long long delta){
+        WriterStripe& s = enterWrite();
+        for(++index; index <= m_len; index += index & (-index))
+            m_tree[index].fetch_add(delta, memory_order_relaxed);
+        exitWrite(s);
+    }
+
+    // Explicitly weak read, see the notes above. Never blocks writers.
+    long long prefixSumWeak(int index) const{
+        return readPath(index);
+    }
+
+    // Linearizable sum of arr[0..index]
+    long long prefixSum(int index){
+        freeze();
+        long long sum = readPath(index);
+        unfreeze();
+        return sum;
+    }
+
+    // Linearizable sum of arr[l..r], both ends read in the same snapshot
+    long long rangeSum(int l, int r){
+        freeze();
+        long long sum = readPath(r) - readPath(l - 1);
+        unfreeze();
+        return sum;
+    }
+
+    // Per-thread write buffer. Not thread safe itself: one Buffer per thread.
+    class Buffer{
+    private:
+        ConcurrentFenwickTree& m_owner;
+        // Local copy of the node array holding only this thread's deltas
+        vector<long long> m_nodeDelta;
+        vector<int> m_dirty;
+        int m_pending;
+        int m_batchSize;
+    public:
+        Buffer(ConcurrentFenwickTree& owner, int batchSize = 1024):
+            m_owner(owner), m_nodeDelta(owner.m_len + 1, 0), 
+            m_pending(0), m_batchSize(batchSize){}
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        ~Buffer(){ flush(); }
+
+        void add(int index, long long delta){
+            for(++index; index <= m_owner.m_len; index += index & (-index)){
+                if(m_nodeDelta[index] == 0)
+                    m_dirty.push_back(index);
+                m_nodeDelta[index] += delta;
+            }
+            if(++m_pending >= m_batchSize)
+                flush();
+        }
+
+        // One fetch_add per dirty node, all inside a single write section so
+        // a linearizable reader sees the whole batch or none of it
+        void flush(){
+            if(m_dirty.empty())
+                return;
+            WriterStripe& s = m_owner.enterWrite();
+            for(int node : m_dirty){
+                // A node whose deltas cancelled out may be listed twice
+                if(m_nodeDelta[node] != 0)
+                    m_owner.m_tree[node].fetch_add(m_nodeDelta[node], memory_order_relaxed);
+                m_nodeDelta[node] = 0;
+            }
+            m_owner.exitWrite(s);
+            m_dirty.clear();
+            m_pending = 0;
+        }
+    };
+};
+
+// Driver program: 32 writers bump a histogram with and without buffering
+int main()
+{
+    const int bins = 1 << 12, writers = 32, addsPerWriter = 1 << 18;
+    for(int buffered = 0; buffered < 2; ++buffered){
+        ConcurrentFenwickTree tree(bins);
+        auto start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for(int t = 0; t < writers; ++t){
+            threads.emplace_back([&, t](){
+                unsigned x = 2463534242u + t;
+                ConcurrentFenwickTree::Buffer buffer(tree);
+                for(int i = 0; i < addsPerWriter; ++i){
+                    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+                    if(buffered)
+                        buffer.add(x % bins, 1);
+                    else
+                        tree.add(x % bins, 1);
+                }
+            });
+        }
+        // Readers may run at any time
+        long long seen = tree.prefixSumWeak(bins - 1);
+        for(auto& t : threads)
+            t.join();
+        chrono::duration<double> sec = chrono::steady_clock::now() - start;
+        cout << (buffered ? "buffered" : "direct  ") << ": " << sec.count() 
+             << "s, partial read " << seen << ", total " << tree.prefixSum(bins - 1)
+             << " (expected " << (long long)writers * addsPerWriter << ")" << endl;
+    }
+    return 0;
+}
+
+
+
+//*********************************************************************
+//28. Arena backed compact Trie
+/*
+The naive Trie in section 9 pays a lot per node:
+    sizeof(TrieNode)                  ~ 32 bytes (bool + vector header)
+    vector<TrieNode*>(26) heap block  208 bytes + malloc header
+and every node is a separate allocation, so a walk down the trie jumps 
+between two unrelated heap blocks per character, and destroy() has to visit
+and free every node one by one (recursively, so deep tries also use a lot of
+stack).
+
+Compact layout:
+1. All nodes live in one contiguous arena (a vector of fixed-size nodes).
+2. Children are 32-bit indices into the arena instead of 64-bit pointers.
+Index 0 is the root and no node can point back to the root, so 0 doubles
+as "no child".
+3. A node is 26 * 4 + 1 bytes, padded to 108, one allocation for the whole 
+trie. Teardown is freeing the arena: nodes are trivially destructible, so 
+it is O(1) no matter how many keys we stored.
+4. Indices stay valid when the arena grows and gets moved, pointers would not.
+Call reserve() with an estimate of the node count to avoid the regrowth 
+copies while loading a large dictionary.
+
+The interface is the same insert/search/startsWith as section 9, plus 
+memoryUsage() and bytesPerKey() so we can see what a dictionary costs.
+Like section 9 the alphabet is 'a'..'z', but other characters are rejected
+instead of indexing out of bounds.
+*/
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+struct CompactTrieNode{
+    // Child index for 'a'..'z', 0 means no child
+    uint32_t branches[26];
+    bool isEnd;
+};
+
+class CompactTrie{
+private:
+    vector<CompactTrieNode> m_nodes;
+    size_t m_keys;
+
+    static bool toBranch(char c, unsigned& branch){
+        branch = static_cast<unsigned char>(c) - 'a';
+        return branch < 26;
+    }
+
+    uint32_t newNode(){
+        m_nodes.push_back(CompactTrieNode());
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+
+    // Returns the node at the end of the path, or 0 if the path breaks
+    // (0 is the root, which can never be the end of a non-empty path)
+    uint32_t walk(string_view key) const{
+        uint32_t node = 0;
+        for(char c : key){
+            unsigned b;
+            if(!toBranch(c, b) || (node = m_nodes[node].branches[b]) == 0)
+                return 0;
+        }
+        return node;
+    }
+public:
+    /** Initialize your data structure here. */
+    CompactTrie(): m_keys(0){
+        newNode();
+    }
+
+    // Pre-size the arena, e.g. to the total number of characters loaded
+    void reserve(size_t nodes){
+        m_nodes.reserve(nodes);
+    }
+
+    // Drops every key at once, the arena is released as a single block
+    void clear(){
+        vector<CompactTrieNode>().swap(m_nodes);
+        m_keys = 0;
+        newNode();
+    }
+
+    /** Inserts a word into the trie. Returns false if it has a character 
+     *  outside 'a'..'z'. */
+    bool insert(string_view word){
+        for(char c : word){
+            unsigned b;
+            if(!toBranch(c, b))
+                return false;
+        }
+        uint32_t node = 0;
+        for(char c : word){
+            unsigned b = static_cast<unsigned char>(c) - 'a';
+            uint32_t next = m_nodes[node].branches[b];
+            if(next == 0){
+                // newNode() may move the arena, so do not hold a reference
+                // to m_nodes[node] across it
+                next = newNode();
+                m_nodes[node].branches[b] = next;
+            }
+            node = next;
+        }
+        if(!m_nodes[node].isEnd){
+            m_nodes[node].isEnd = true;
+            ++m_keys;
+        }
+        return true;
+    }
+
+    /** Returns if the word is in the trie. */
+    bool search(string_view word) const{
+        if(word.empty())
+            return m_nodes[0].isEnd;
+        uint32_t node = walk(word);
+        return node != 0 && m_nodes[node].isEnd;
+    }
+
+    /** Returns if there is any word in the trie that starts with the given prefix. */
+    bool startsWith(string_view prefix) const{
+        return prefix.empty() || walk(prefix) != 0;
+    }
+
+    /** found[i] = search(keys[i]). Walks up to kLanes keys at the same time 
+     *  and prefetches the next node of every key, see section 33. */
+    void searchMany(const string_view* keys, size_t count, bool* found) const{
+        const size_t kLanes = 16;
+        struct Lane{ size_t key; size_t depth; uint32_t node; };
+        Lane lanes[kLanes];
+        size_t active = 0, next = 0;
+        while(active < kLanes && next < count)
+            lanes[active++] = Lane{next++, 0, 0};
+
+        while(active > 0){
+            for(size_t i = 0; i < active; ){
+                Lane& lane = lanes[i];
+                string_view key = keys[lane.key];
+                bool done = false;
+                unsigned b;
+                if(lane.depth == key.size()){
+                    found[lane.key] = m_nodes[lane.node].isEnd;
+                    done = true;
+                }else if(!toBranch(key[lane.depth], b) 
+                         || (lane.node = m_nodes[lane.node].branches[b]) == 0){
+                    found[lane.key] = false;
+                    done = true;
+                }else{
+                    // Start loading the exact slot the next step will read,
+                    // then go on with the other lanes while it arrives
+                    ++lane.depth;
+                    const CompactTrieNode& n = m_nodes[lane.node];
+                    if(lane.depth < key.size() && toBranch(key[lane.depth], b))
+                        __builtin_prefetch(&n.branches[b]);
+                    else
+                        __builtin_prefetch(&n.isEnd);
+                }
+
+                if(!done)
+                    ++i;
+                else if(next < count)
+                    lane = Lane{next++, 0, 0};
+                else
+                    lane = lanes[--active];
+            }
+        }
+    }
+
+    size_t size() const { return m_keys; }
+    size_t nodeCount() const { return m_nodes.size(); }
+
+    // Bytes held by the arena (including the reserved but unused tail)
+    size_t memoryUsage() const{
+        return sizeof(*this) + m_nodes.capacity() * sizeof(CompactTrieNode);
+    }
+
+    double bytesPerKey() const{
+        return m_keys == 0 ? 0.0 : double(memoryUsage()) / double(m_keys);
+    }
+};
+
+// Driver program to test above class
+int main()
+{
+    CompactTrie trie;
+    const char* words[] = {"apple", "app", "application", "banana", "band", "bandana"};
+    for(auto w : words)
+        trie.insert(w);
+
+    cout << trie.search("app") << trie.search("appl") << trie.startsWith("appl")
+         << trie.search("bandana") << trie.search("Band") << endl;
+    cout << trie.size() << " keys, " << trie.nodeCount() << " nodes, "
+         << trie.bytesPerKey() << " bytes per key" << endl;
+    // The section 9 node costs sizeof(TrieNode) + 26 pointers + malloc header
+    cout << "Section 9 trie would use about " 
+         << trie.nodeCount() * (32 + 26 * sizeof(void*) + 16) / trie.size()
+         << " bytes per key" << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//29. Adaptive radix tree (path compressed radix trie over bytes)
+//https://db.in.tum.de/~leis/papers/ART.pdf
+/*
+The Trie in section 9 indexes branches[word[i] - 'a'], so any byte outside 
+'a'..'z' (upper case, '/', ':', digits, UTF-8) indexes out of bounds. It also
+creates one node per character, even on a long suffix that only one key has,
+which is the common case for URLs and file paths.
+
+Two ideas fix both problems:
+1. Path compression: a node stores the bytes shared by everything below it 
+(prefix). A chain of single-child nodes collapses into one node, so a unique 
+suffix costs one node no matter how long it is.
+2. Adaptive node sizes (ART): most nodes have few children, a few near the 
+top have many. Four node layouts, grown when they fill up:
+    Node4   : 4 sorted key bytes + 4 child pointers, linear search
+    Node16  : 16 sorted key bytes + 16 child pointers, one SSE2 compare of 
+              all 16 bytes, movemask + count trailing zeros gives the slot
+    Node48  : 256 byte index (slot + 1, 0 = empty) + 48 child pointers
+    Node256 : 256 child pointers, direct indexing
+So a byte alphabet costs 4 pointers per node in the common case instead of 
+256, and a child lookup is always a handful of instructions.
+
+A key can end inside the tree (e.g. "app" and "apple"), so every node has an
+isEnd flag like section 9 instead of storing separate leaves.
+
+Insertion, at node n with remaining key k:
+1. Compare n->prefix with k. If they differ at position p, split: a new 
+Node4 takes prefix[0..p), n keeps prefix[p+1..) under key byte prefix[p], and 
+the rest of k goes under its own byte (or marks isEnd on the new node).
+2. If k is used up, set isEnd.
+3. Otherwise follow the child for the next byte, or add a new node holding 
+the whole remaining suffix as its prefix (growing n if it is full).
+
+Keys are string_view (C++17), so probing with a substring of a URL or a 
+char buffer does not copy it.
+*/
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+enum class ArtKind : uint8_t { Node4, Node16, Node48, Node256 };
+
+struct ArtNode{
+    ArtKind kind;
+    bool isEnd;
+    uint16_t count;
+    // Compressed path: bytes every key below this node shares after the 
+    // edge byte that led here
+    string prefix;
+    ArtNode(ArtKind k): kind(k), isEnd(false), count(0){}
+};
+
+struct ArtNode4 : ArtNode{
+    uint8_t keys[4];
+    ArtNode* children[4];
+    ArtNode4(): ArtNode(ArtKind::Node4){}
+};
+
+struct ArtNode16 : ArtNode{
+    uint8_t keys[16];
+    ArtNode* children[16];
+    ArtNode16(): ArtNode(ArtKind::Node16){}
+};
+
+struct ArtNode48 : ArtNode{
+    // childIndex[b] is slot + 1 in children[], 0 means no child
+    uint8_t childIndex[256];
+    ArtNode* children[48];
+    ArtNode48(): ArtNode(ArtKind::Node48){ memset(childIndex, 0, sizeof(childIndex)); }
+};
+
+struct ArtNode256 : ArtNode{
+    ArtNode* children[256];
+    ArtNode256(): ArtNode(ArtKind::Node256){ memset(children, 0, sizeof(children)); }
+};
+
+class RadixTrie{
+private:
+    ArtNode* root;
+    size_t m_keys;
+
+    // Returns the slot holding the child for byte b, or nullptr
+    static ArtNode** findChild(ArtNode* node, uint8_t b){
+        switch(node->kind){
+        case ArtKind::Node4:{
+            ArtNode4* n = static_cast<ArtNode4*>(node);
+            for(int i = 0; i < n->count; ++i)
+                if(n->keys[i] == b)
+                    return &n->children[i];
+            return nullptr;
+        }
+        case ArtKind::Node16:{
+            ArtNode16* n = static_cast<ArtNode16*>(node);
+#ifdef __SSE2__
+            __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(b)),
+                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(n->keys)));
+            // keys[] past count are garbage, mask them out
+            unsigned mask = _mm_movemask_epi8(cmp) & ((1u << n->count) - 1);
+            return mask ? &n->children[__builtin_ctz(mask)] : nullptr;
+#else
+            for(int i = 0; i < n->count; ++i)
+                if(n->keys[i] == b)
+                    return &n->children[i];
+            return nullptr;
+#endif
+        }
+        case ArtKind::Node48:{
+            ArtNode48* n = static_cast<ArtNode48*>(node);
+            return n->childIndex[b] ? &n->children[n->childIndex[b] - 1] : nullptr;
+        }
+        case ArtKind::Node256:{
+            ArtNode256* n = static_cast<ArtNode256*>(node);
+            return n->children[b] ? &n->children[b] : nullptr;
+        }
+        }
+        return nullptr;
+    }
+
+    // Inserts into a sorted key/child array of a Node4 or Node16
+    template<typename N>
+    static void insertSorted(N* n, uint8_t b, ArtNode* child){
+        int i = n->count;
+        while(i > 0 && n->keys[i - 1] > b){
+            n->keys[i] = n->keys[i - 1];
+            n->children[i] = n->children[i - 1];
+            --i;
+        }
+        n->keys[i] = b;
+        n->children[i] = child;
+        ++n->count;
+    }
+
+    // Moves the header (prefix, isEnd) of from into to, frees from
+    template<typename From>
+    static void retire(From* from, ArtNode* to){
+        to->isEnd = from->isEnd;
+        to->prefix = std::move(from->prefix);
+        delete from;
+    }
+
+    // Adds child under byte b. A full node is replaced by the next size up,
+    // so the parent slot (ref) is updated too.
+    static void addChild(ArtNode** ref, uint8_t b, ArtNode* child){
+        ArtNode* node = *ref;
+        switch(node->kind){
+        case ArtKind::Node4:{
+            ArtNode4* n = static_cast<ArtNode4*>(node);
+            if(n->count < 4){
+                insertSorted(n, b, child);
+                return;
+            }
+            ArtNode16* bigger = new ArtNode16();
+            memcpy(bigger->keys, n->keys, 4);
+            memcpy(bigger->children, n->children, 4 * sizeof(ArtNode*));
+            bigger->count = 4;
+            retire(n, bigger);
+            insertSorted(bigger, b, child);
+            *ref = bigger;
+            return;
+        }
+        case ArtKind::Node16:{
+            ArtNode16* n = static_cast<ArtNode16*>(node);
+            if(n->count < 16){
+                insertSorted(n, b, child);
+                return;
+            }
+            ArtNode48* bigger = new ArtNode48();
+            for(int i = 0; i < 16; ++i){
+                bigger->children[i] = n->children[i];
+                bigger->childIndex[n->keys[i]] = static_cast<uint8_t>(i + 1);
+            }
+            bigger->count = 16;
+            retire(n, bigger);
+            *ref = bigger;
+            addChild(ref, b, child);
+            return;
+        }
+        case ArtKind::Node48:{
+            ArtNode48* n = static_cast<ArtNode48*>(node);
+            if(n->count < 48){
+                // No deletion, so slots are always filled in order
+                n->children[n->count] = child;
+                n->childIndex[b] = static_cast<uint8_t>(++n->count);
+                return;
+            }
+            ArtNode256* bigger = new ArtNode256();
+            for(int c = 0; c < 256; ++c)
+                if(n->childIndex[c])
+                    bigger->children[c] = n->children[n->childIndex[c] - 1];
+            bigger->count = 48;
+            retire(n, bigger);
+            *ref = bigger;
+            addChild(ref, b, child);
+            return;
+        }
+        case ArtKind::Node256:{
+            ArtNode256* n = static_cast<ArtNode256*>(node);
+            n->children[b] = child;
+            ++n->count;
+            return;
+        }
+        }
+    }
+
+    static ArtNode4* newLeaf(string_view suffix){
+        ArtNode4* leaf = new ArtNode4();
+        leaf->prefix.assign(suffix.data(), suffix.size());
+        leaf->isEnd = true;
+        return leaf;
+    }
+
+    static void deleteNode(ArtNode* node){
+        switch(node->kind){
+        case ArtKind::Node4:   delete static_cast<ArtNode4*>(node); break;
+        case ArtKind::Node16:  delete static_cast<ArtNode16*>(node); break;
+        case ArtKind::Node48:  delete static_cast<ArtNode48*>(node); break;
+        case ArtKind::Node256: delete static_cast<ArtNode256*>(node); break;
+        }
+    }
+
+    // Node at the end of key, or nullptr. If partial is set the key may end
+    // in the middle of a node prefix (prefix query).
+    const ArtNode* walk(string_view key, bool partial) const{
+        ArtNode* node = root;
+        size_t depth = 0;
+        for(;;){
+            const string& p = node->prefix;
+            size_t rest = key.size() - depth;
+            if(rest < p.size()){
+                return partial && p.compare(0, rest, key.data() + depth, rest) == 0 
+                    ? node : nullptr;
+            }
+            if(p.compare(0, p.size(), key.data() + depth, p.size()) != 0)
+                return nullptr;
+            depth += p.size();
+            if(depth == key.size())
+                return node;
+            ArtNode** child = findChild(node, static_cast<uint8_t>(key[depth]));
+            if(!child)
+                return nullptr;
+            node = *child;
+            ++depth;
+        }
+    }
+public:
+    RadixTrie(): root(new ArtNode4()), m_keys(0){}
+    RadixTrie(const RadixTrie&) = delete;
+    RadixTrie& operator=(const RadixTrie&) = delete;
+
+    ~RadixTrie(){
+        // Explicit stack, very long keys must not overflow the call stack
+        vector<ArtNode*> stack(1, root);
+        while(!stack.empty()){
+            ArtNode* node = stack.back();
+            stack.pop_back();
+            switch(node->kind){
+            case ArtKind::Node4:{
+                ArtNode4* n = static_cast<ArtNode4*>(node);
+                stack.insert(stack.end(), n->children, n->children + n->count);
+                break;
+            }
+            case ArtKind::Node16:{
+                ArtNode16* n = static_cast<ArtNode16*>(node);
+                stack.insert(stack.end(), n->children, n->children + n->count);
+                break;
+            }
+            case ArtKind::Node48:{
+                ArtNode48* n = static_cast<ArtNode48*>(node);
+                stack.insert(stack.end(), n->children, n->children + n->count);
+                break;
+            }
+            case ArtKind::Node256:{
+                ArtNode256* n = static_cast<ArtNode256*>(node);
+                for(ArtNode* c : n->children)
+                    if(c)
+                        stack.push_back(c);
+                break;
+            }
+            }
+            deleteNode(node);
+        }
+    }
+
+    /** Inserts a key, returns false if it was already there. */
+    bool insert(string_view key){
+        ArtNode** ref = &root;
+        size_t depth = 0;
+        for(;;){
+            ArtNode* node = *ref;
+            const string& p = node->prefix;
+            size_t match = 0;
+            while(match < p.size() && depth + match < key.size() 
+                  && p[match] == key[depth + match])
+                ++match;
+
+            if(match < p.size()){
+                // Split the compressed path at the first mismatch
+                ArtNode4* parent = new ArtNode4();
+                parent->prefix = p.substr(0, match);
+                uint8_t oldByte = static_cast<uint8_t>(p[match]);
+                node->prefix.erase(0, match + 1);
+                insertSorted(parent, oldByte, node);
+                if(depth + match == key.size())
+                    parent->isEnd = true;
+                else
+                    insertSorted(parent, static_cast<uint8_t>(key[depth + match]),
+                                 newLeaf(key.substr(depth + match + 1)));
+                *ref = parent;
+                ++m_keys;
+                return true;
+            }
+
+            depth += match;
+            if(depth == key.size()){
+                if(node->isEnd)
+                    return false;
+                node->isEnd = true;
+                ++m_keys;
+                return true;
+            }
+
+            uint8_t b = static_cast<uint8_t>(key[depth]);
+            ArtNode** child = findChild(node, b);
+            if(!child){
+                addChild(ref, b, newLeaf(key.substr(depth + 1)));
+                ++m_keys;
+                return true;
+            }
+            ref = child;
+            ++depth;
+        }
+    }
+
+    /** Returns if the key is in the trie. */
+    bool search(string_view key) const{
+        const ArtNode* node = walk(key, false);
+        return node && node->isEnd;
+    }
+
+    /** Returns if there is any key in the trie that starts with the given prefix. */
+    bool startsWith(string_view prefix) const{
+        // Every node below the root has at least one key under it. The empty
+        // prefix stops at the root and is always true, like section 9.
+        return walk(prefix, true) != nullptr;
+    }
+
+    size_t size() const { return m_keys; }
+};
+
+// Driver program: correctness on arbitrary bytes, then lookups on URL-like 
+// keys against the 26-ary CompactTrie of section 28. The URLs are spelled 
+// with letters only so that the 26-ary trie can hold them at all.
+#include <algorithm>
+#include <chrono>
+#include <random>
+int main()
+{
+    RadixTrie art;
+    art.insert("https://example.com/a");
+    art.insert("https://example.com/ab");
+    art.insert(string("bin\0ary", 7));
+    art.insert("/usr/local/bin");
+    cout << art.search("https://example.com/a") << art.search("https://example.com/")
+         << art.startsWith("https://ex") << art.search(string("bin\0ary", 7))
+         << art.startsWith("/usr/local/bin/") << endl;
+
+    mt19937 rng(42);
+    const char* hosts[] = {"httpwwwexamplecom", "httpsapiexampleorg", "httpcdnstaticnet"};
+    const char* dirs[] = {"users", "images", "static", "download", "archive", "docs"};
+    vector<string> keys;
+    for(int i = 0; i < 200000; ++i){
+        string k = hosts[rng() % 3];
+        for(int d = 0; d < 4; ++d){
+            k += dirs[rng() % 6];
+            for(int j = 0; j < 6; ++j)
+                k += char('a' + rng() % 26);
+        }
+        keys.push_back(k);
+    }
+
+    RadixTrie radix;
+    CompactTrie compact;
+    for(auto& k : keys){
+        radix.insert(k);
+        compact.insert(k);
+    }
+    shuffle(keys.begin(), keys.end(), rng);
+
+    auto time = [&](auto&& lookup){
+        auto start = chrono::steady_clock::now();
+        size_t found = 0;
+        for(auto& k : keys)
+            found += lookup(k);
+        chrono::duration<double, nano> ns = chrono::steady_clock::now() - start;
+        cout << ns.count() / keys.size() << " ns per lookup, found " << found << endl;
+    };
+    cout << "RadixTrie:   "; time([&](const string& k){ return radix.search(k); });
+    cout << "CompactTrie: "; time([&](const string& k){ return compact.search(k); });
+    return 0;
+}
+
+
+
+//*********************************************************************
+//30. Top-K autocomplete on a Trie with cached subtree scores
+/*
+Trie::startsWith() in section 9 only answers yes or no. To autocomplete we 
+would have to DFS the whole subtree under the prefix node and sort it, and 
+for a short prefix like "a" that is a large part of the dictionary.
+
+Idea: every node caches the best K words of its subtree (highest weight 
+first, ties broken by insertion order). Then complete(prefix, k) for k <= K 
+walks the prefix and copies the first k entries of the cache:
+O(|prefix| + k) nodes touched, independent of the subtree size.
+
+Keeping the caches right is an update along the path from the word's node
+up to the root, bottom up:
+1. Insert, or a weight increase: the only candidate that changed is the word
+itself. At each ancestor, if it is already cached re-sort it in place, else 
+insert it if the cache is not full or it beats the last entry. If it does not
+make it into a node's cache it cannot make it into any ancestor's (their 
+candidates are a superset), so we stop there.
+2. A weight decrease: if the word is not in a node's cache nothing changes 
+there or above, so we stop. If it is, some word outside the cache may now 
+belong in it, so the cache is rebuilt by merging the node's own word with 
+the (already correct) caches of its children. 
+Each step is O(K) or O(children * K), for O(depth * children * K) worst case.
+
+For k > K we cannot use the cache alone, but best[0] is the max score of the
+subtree. A best-first search over a priority queue of (max score, node) and 
+(weight, word) entries pops words in exactly descending order, touching 
+O(k * branching) nodes and O(k log k) heap work instead of the whole subtree.
+*/
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <queue>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+using namespace std;
+
+class AutocompleteTrie{
+private:
+    struct Node{
+        // Sorted by edge byte
+        vector<pair<uint8_t, uint32_t>> children;
+        // Best K word ids of the subtree, best first
+        vector<uint32_t> best;
+        uint32_t parent;
+        // Word ending here, or -1
+        int32_t word;
+        Node(uint32_t p): parent(p), word(-1){}
+    };
+    vector<Node> m_nodes;
+    vector<string> m_words;
+    vector<long long> m_weight;
+    vector<uint32_t> m_wordNode;
+    size_t m_cacheK;
+
+    // True if word a ranks before word b
+    bool better(uint32_t a, uint32_t b) const{
+        return m_weight[a] != m_weight[b] ? m_weight[a] > m_weight[b] : a < b;
+    }
+
+    uint32_t child(uint32_t node, uint8_t b) const{
+        const auto& ch = m_nodes[node].children;
+        auto it = lower_bound(ch.begin(), ch.end(), make_pair(b, uint32_t(0)));
+        return it != ch.end() && it->first == b ? it->second : 0;
+    }
+
+    // 0 if the prefix is not in the trie (the root is never a child)
+    uint32_t walk(string_view prefix) const{
+        uint32_t node = 0;
+        for(char c : prefix)
+            if((node = child(node, static_cast<uint8_t>(c))) == 0)
+                return 0;
+        return node;
+    }
+
+    // Case 1 above. Returns false once the word did not make it into the cache.
+    bool promote(uint32_t node, uint32_t w){
+        vector<uint32_t>& best = m_nodes[node].best;
+        auto it = find(best.begin(), best.end(), w);
+        if(it == best.end()){
+            if(best.size() == m_cacheK && !better(w, best.back()))
+                return false;
+            if(best.size() == m_cacheK)
+                best.pop_back();
+            best.push_back(w);
+            it = best.end() - 1;
+        }
+        // Bubble the entry towards the front, the rest is still sorted
+        for(; it != best.begin() && better(*it, *(it - 1)); --it)
+            iter_swap(it, it - 1);
+        return true;
+    }
+
+    // Case 2 above: rebuild from the node's own word and its children's caches
+    void rebuild(uint32_t node){
+        Node& n = m_nodes[node];
+        vector<uint32_t> candidates;
+        if(n.word >= 0)
+            candidates.push_back(n.word);
+        for(auto& c : n.children){
+            const auto& cb = m_nodes[c.second].best;
+            candidates.insert(candidates.end(), cb.begin(), cb.end());
+        }
+        size_t keep = min(m_cacheK, candidates.size());
+        partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(),
+                     [this](uint32_t a, uint32_t b){ return better(a, b); });
+        candidates.resize(keep);
+        n.best.swap(candidates);
+    }
+
+    // Cases 1 and 2 above for a word that is already in the trie
+    void setWeight(uint32_t w, long long weight){
+        long long old = m_weight[w];
+        m_weight[w] = weight;
+        if(weight == old)
+            return;
+        uint32_t n = m_wordNode[w];
+        if(weight > old){
+            while(promote(n, w) && n != 0)
+                n = m_nodes[n].parent;
+            return;
+        }
+        for(;;){
+            const auto& best = m_nodes[n].best;
+            if(find(best.begin(), best.end(), w) == best.end())
+                break;
+            rebuild(n);
+            if(n == 0)
+                break;
+            n = m_nodes[n].parent;
+        }
+    }
+public:
+    // Every node caches at least its best word: promote() compares against
+    // the last cached entry, which an empty cache would not have
+    explicit AutocompleteTrie(size_t cacheK = 10): m_nodes(1, Node(0)), 
+        m_cacheK(max<size_t>(1, cacheK)){}
+
+    /** Inserts a word with its weight, or changes the weight of an existing word. */
+    void insert(string_view word, long long weight){
+        uint32_t node = 0;
+        for(char c : word){
+            uint8_t b = static_cast<uint8_t>(c);
+            uint32_t next = child(node, b);
+            if(next == 0){
+                next = static_cast<uint32_t>(m_nodes.size());
+                m_nodes.push_back(Node(node));
+                auto& ch = m_nodes[node].children;
+                ch.insert(lower_bound(ch.begin(), ch.end(), make_pair(b, uint32_t(0))),
+                          make_pair(b, next));
+            }
+            node = next;
+        }
+
+        if(m_nodes[node].word < 0){
+            m_nodes[node].word = static_cast<int32_t>(m_words.size());
+            m_words.emplace_back(word);
+            m_weight.push_back(weight);
+            m_wordNode.push_back(node);
+            // A new word only adds a candidate
+            uint32_t w = m_nodes[node].word;
+            for(uint32_t n = node; promote(n, w) && n != 0; n = m_nodes[n].parent);
+            return;
+        }
+        setWeight(m_nodes[node].word, weight);
+    }
+
+    /** Returns the k highest weight words starting with prefix, best first. */
+    vector<pair<string, long long>> complete(string_view prefix, size_t k) const{
+        vector<pair<string, long long>> result;
+        uint32_t node = walk(prefix);
+        if(node == 0 && !prefix.empty())
+            return result;
+
+        const vector<uint32_t>& best = m_nodes[node].best;
+        if(k <= m_cacheK || best.size() < m_cacheK){
+            for(size_t i = 0; i < best.size() && i < k; ++i)
+                result.emplace_back(m_words[best[i]], m_weight[best[i]]);
+            return result;
+        }
+
+        // Best-first search. An entry is a node (ranked by its best word) 
+        // or a word; a node always ranks with its best word, so popping a 
+        // word means nothing left can beat it.
+        struct Entry{ uint32_t rankWord; uint32_t id; bool isNode; };
+        auto cmp = [this](const Entry& a, const Entry& b){
+            if(a.rankWord != b.rankWord)
+                return better(b.rankWord, a.rankWord);
+            // Expand a node before emitting the word it is ranked by
+            return !a.isNode && b.isNode;
+        };
+        priority_queue<Entry, vector<Entry>, decltype(cmp)> pq(cmp);
+        pq.push({best[0], node, true});
+        while(!pq.empty() && result.size() < k){
+            Entry e = pq.top();
+            pq.pop();
+            if(!e.isNode){
+                result.emplace_back(m_words[e.id], m_weight[e.id]);
+                continue;
+            }
+            const Node& n = m_nodes[e.id];
+            if(n.word >= 0)
+                pq.push({static_cast<uint32_t>(n.word), static_cast<uint32_t>(n.word), false});
+            for(auto& c : n.children)
+                if(!m_nodes[c.second].best.empty())
+                    pq.push({m_nodes[c.second].best[0], c.second, true});
+        }
+        return result;
+    }
+
+    bool search(string_view word) const{
+        uint32_t node = walk(word);
+        return (node != 0 || word.empty()) && m_nodes[node].word >= 0;
+    }
+
+    bool startsWith(string_view prefix) const{
+        return prefix.empty() || walk(prefix) != 0;
+    }
+};
+
+// Driver program to test above class
+int main()
+{
+    AutocompleteTrie trie(2);
+    trie.insert("car", 50);
+    trie.insert("card", 70);
+    trie.insert("care", 20);
+    trie.insert("careful", 90);
+    trie.insert("cat", 60);
+    trie.insert("dog", 100);
+
+    auto print = [](const vector<pair<string, long long>>& words){
+        for(auto& w : words)
+            cout << w.first << "(" << w.second << ") ";
+        cout << endl;
+    };
+    print(trie.complete("ca", 2));   // careful card
+    print(trie.complete("ca", 4));   // careful card cat car (best-first search)
+    trie.insert("careful", 10);      // weight decrease, caches get rebuilt
+    print(trie.complete("car", 2));  // card car
+    trie.insert("care", 80);         // weight increase
+    print(trie.complete("", 3));     // dog care card
+    return 0;
+}
+
+
+
+//*********************************************************************
+//31. Immutable memory mapped Trie image
+/*
+Every process start rebuilds the dictionary with Trie::insert() word by word 
+(section 9): tens of seconds for a large vocabulary, and every worker on the
+host holds its own private copy of the same nodes.
+
+Instead we build the trie once offline and write it out as a flat, pointer 
+free image. At startup a worker mmap()s the file read-only and searches it in
+place: nothing is deserialized, startup is O(1), and because the mapping is 
+MAP_SHARED on a read-only file, all workers share the same physical pages
+through the page cache. open() only checks the header against the file 
+size; child() checks every edge range and child id it follows against the 
+counts, so a corrupt image cannot make a lookup read outside the mapping 
+(it just answers "not found").
+
+Image layout (host byte order, every array 4-byte aligned):
+    Header   magic "TRIEIMG1", version, nodeCount, edgeCount
+    nodes    nodeCount x { uint32 firstEdge; uint16 edgeCount; uint8 isEnd; pad }
+    targets  edgeCount x uint32    child node id of every edge
+    labels   edgeCount x uint8     edge byte, sorted within a node
+Node 0 is the root. The edges of a node are the contiguous range 
+[firstEdge, firstEdge + edgeCount), so finding a child is a binary search in 
+a few bytes of labels[] and one load from targets[]. Labels and targets are 
+separate arrays so the search only touches the label bytes.
+(This is the flat sorted-edge form of a static trie; a double array would 
+save the binary search but is much harder to build, and this is already 
+pointer free and mmap friendly.)
+
+Offline build without a pointer trie:
+Sort the words. Every trie node is then a range [lo, hi) of the sorted words
+that share the first depth bytes; words of length == depth come first and set
+isEnd, the rest split into runs of equal word[depth], one child per run. 
+Processing the ranges in BFS order gives children consecutive ids and edges 
+in node order, so the whole image is written in O(total characters).
+*/
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <queue>
+#include <tuple>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+struct TrieImageHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t nodeCount;
+    uint64_t edgeCount;
+};
+
+struct TrieImageNode{
+    uint32_t firstEdge;
+    uint16_t edgeCount;
+    uint8_t isEnd;
+    uint8_t pad;
+};
+
+// Offline builder. Returns false if the file could not be written.
+bool writeTrieImage(vector<string> words, const string& path)
+{
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+
+    vector<TrieImageNode> nodes(1, TrieImageNode());
+    vector<uint32_t> targets;
+    vector<uint8_t> labels;
+
+    // (lo, hi, depth) of every node, in node id order
+    queue<tuple<size_t, size_t, size_t>> ranges;
+    ranges.push(make_tuple(0, words.size(), 0));
+    for(uint32_t id = 0; !ranges.empty(); ++id){
+        size_t lo, hi, depth;
+        tie(lo, hi, depth) = ranges.front();
+        ranges.pop();
+
+        // Shorter words sort first, so the word ending here (if any) is at lo
+        if(lo < hi && words[lo].size() == depth){
+            nodes[id].isEnd = 1;
+            ++lo;
+        }
+        nodes[id].firstEdge = static_cast<uint32_t>(targets.size());
+        while(lo < hi){
+            uint8_t b = static_cast<uint8_t>(words[lo][depth]);
+            size_t run = lo;
+            while(run < hi && static_cast<uint8_t>(words[run][depth]) == b)
+                ++run;
+            labels.push_back(b);
+            targets.push_back(static_cast<uint32_t>(nodes.size()));
+            nodes.push_back(TrieImageNode());
+            ranges.push(make_tuple(lo, run, depth + 1));
+            ++nodes[id].edgeCount;
+            lo = run;
+        }
+    }
+
+    TrieImageHeader header;
+    memcpy(header.magic, "TRIEIMG1", 8);
+    header.version = 1;
+    header.nodeCount = static_cast<uint32_t>(nodes.size());
+    header.edgeCount = targets.size();
+
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(TrieImageNode));
+    out.write(reinterpret_cast<const char*>(targets.data()), targets.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(labels.data()), labels.size());
+    return static_cast<bool>(out);
+}
+
+// Read-only view over a mapped image. search/startsWith work in place.
+class MappedTrie{
+private:
+    void* m_base;
+    size_t m_length;
+    const TrieImageNode* m_nodes;
+    const uint32_t* m_targets;
+    const uint8_t* m_labels;
+    uint32_t m_nodeCount;
+    uint64_t m_edgeCount;
+
+    // Child of node for byte b, or -1. Ranges and ids come from the file, 
+    // so they are checked here, on the path actually walked, instead of 
+    // over the whole image in open(). node itself is always < m_nodeCount.
+    int64_t child(uint32_t node, uint8_t b) const{
+        const TrieImageNode& n = m_nodes[node];
+        if(uint64_t(n.firstEdge) + n.edgeCount > m_edgeCount)
+            return -1;
+        const uint8_t* first = m_labels + n.firstEdge;
+        const uint8_t* last = first + n.edgeCount;
+        const uint8_t* it = std::lower_bound(first, last, b);
+        if(it == last || *it != b)
+            return -1;
+        uint32_t target = m_targets[it - m_labels];
+        return target < m_nodeCount ? int64_t(target) : -1;
+    }
+
+    int64_t walk(string_view key) const{
+        if(m_nodeCount == 0)
+            return -1;          // not open
+        int64_t node = 0;
+        for(char c : key)
+            if((node = child(static_cast<uint32_t>(node), static_cast<uint8_t>(c))) < 0)
+                return -1;
+        return node;
+    }
+public:
+    MappedTrie(): m_base(nullptr), m_length(0), m_nodes(nullptr), 
+        m_targets(nullptr), m_labels(nullptr), m_nodeCount(0), m_edgeCount(0){}
+    MappedTrie(const MappedTrie&) = delete;
+    MappedTrie& operator=(const MappedTrie&) = delete;
+    ~MappedTrie(){ close(); }
+
+    // Maps the image, returns false if it is missing or malformed
+    bool open(const string& path){
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return false;
+        struct stat st;
+        if(fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(TrieImageHeader)){
+            ::close(fd);
+            return false;
+        }
+        m_length = st.st_size;
+        m_base = mmap(nullptr, m_length, PROT_READ, MAP_SHARED, fd, 0);
+        // The mapping keeps its own reference to the file
+        ::close(fd);
+        if(m_base == MAP_FAILED){
+            m_base = nullptr;
+            return false;
+        }
+
+        const char* p = static_cast<const char*>(m_base);
+        const TrieImageHeader* header = reinterpret_cast<const TrieImageHeader*>(p);
+        // Sizes are checked by subtraction and division, counts from a bad
+        // file must not overflow the arithmetic into the right length
+        size_t payload = m_length - sizeof(TrieImageHeader);
+        size_t nodeBytes = size_t(header->nodeCount) * sizeof(TrieImageNode);
+        const size_t edgeBytes = sizeof(uint32_t) + 1;
+        if(memcmp(header->magic, "TRIEIMG1", 8) != 0 || header->version != 1 
+           || header->nodeCount == 0 || nodeBytes > payload
+           || (payload - nodeBytes) % edgeBytes != 0
+           || header->edgeCount != (payload - nodeBytes) / edgeBytes){
+            close();
+            return false;
+        }
+        m_nodes = reinterpret_cast<const TrieImageNode*>(p + sizeof(TrieImageHeader));
+        m_targets = reinterpret_cast<const uint32_t*>(m_nodes + header->nodeCount);
+        m_labels = reinterpret_cast<const uint8_t*>(m_targets + header->edgeCount);
+        m_nodeCount = header->nodeCount;
+        m_edgeCount = header->edgeCount;
+        // We will walk it randomly, do not waste I/O on read-ahead
+        madvise(m_base, m_length, MADV_RANDOM);
+        return true;
+    }
+
+    void close(){
+        if(m_base)
+            munmap(m_base, m_length);
+        m_base = nullptr;
+        m_length = 0;
+        m_nodeCount = 0;
+        m_edgeCount = 0;
+    }
+
+    bool isOpen() const { return m_base != nullptr; }
+
+    /** Returns if the word is in the trie. */
+    bool search(string_view word) const{
+        int64_t node = walk(word);
+        return node >= 0 && m_nodes[node].isEnd;
+    }
+
+    /** Returns if there is any word in the trie that starts with the given prefix. */
+    bool startsWith(string_view prefix) const{
+        return walk(prefix) >= 0;
+    }
+};
+
+// Driver program to test above functions
+int main()
+{
+    vector<string> words = {"apple", "app", "application", "banana", "band", "bandana"};
+    if(!writeTrieImage(words, "/tmp/dictionary.trie")){
+        cout << "Could not write the image" << endl;
+        return 1;
+    }
+
+    // Typically this runs in every worker process
+    MappedTrie trie;
+    if(!trie.open("/tmp/dictionary.trie")){
+        cout << "Could not map the image" << endl;
+        return 1;
+    }
+    cout << trie.search("app") << trie.search("appl") << trie.startsWith("appl")
+         << trie.search("bandana") << trie.startsWith("bank") << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//32. Read-mostly concurrent Trie: path copying + epoch based reclamation
+/*
+The dictionary is read by every request thread and updated by one loader 
+thread. The raw pointer Trie in section 9 has no synchronization at all, and 
+a mutex (even a shared_mutex) makes every reader write to the same lock word,
+so reads stop scaling with cores.
+
+Readers never lock here:
+1. Published nodes are immutable. A writer never changes a node a reader 
+can see. To insert a word it copies the nodes on the path from the root to 
+the word (path copying), links the copies to the untouched subtrees, and 
+publishes the new root with one atomic store. A reader loads the root once 
+and sees one complete version of the trie for the whole lookup.
+2. The replaced path nodes can not be freed right away, a reader may still 
+be walking the old version. Epoch based reclamation (EBR):
+    - A global epoch counter.
+    - Every reader thread owns a slot on its own cache line. Entering a read 
+      it stores the current global epoch there, leaving it stores 0.
+    - After publishing, the writer tags the replaced nodes with the current 
+      epoch e, then moves the global epoch to e+1.
+    - A batch tagged e can be freed once every busy slot shows an epoch > e:
+      such a reader entered after the publish and can only see the new root.
+   The reader's only shared write is to its own slot, so reads scale.
+3. insertBatch() applies many words to one private draft and publishes once.
+Nodes created inside the draft are not visible yet, so they are updated in 
+place instead of being copied again for every word.
+
+All the ordering relies on seq_cst: the reader's slot store comes before its
+root load, and the writer's root exchange comes before its epoch increment
+and its slot scan, so a reader that can still see an old node always shows 
+up in the scan with an epoch <= the tag of that node.
+*/
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+using namespace std;
+
+// Small ids for reader threads, recycled when a thread exits
+class ReaderSlotId{
+private:
+    static mutex& lock(){ static mutex m; return m; }
+    static vector<int>& freeIds(){ static vector<int> ids; return ids; }
+    static int& nextId(){ static int next = 0; return next; }
+    int m_id;
+
+    ReaderSlotId(){
+        lock_guard<mutex> guard(lock());
+        if(freeIds().empty()){
+            m_id = nextId()++;
+        }else{
+            m_id = freeIds().back();
+            freeIds().pop_back();
+        }
+    }
+    ~ReaderSlotId(){
+        lock_guard<mutex> guard(lock());
+        freeIds().push_back(m_id);
+    }
+public:
+    static int current(){
+        static thread_local ReaderSlotId id;
+        return id.m_id;
+    }
+};
+
+class SnapshotTrie{
+private:
+    struct Node{
+        bool isEnd = false;
+        // Sorted by edge byte, immutable once published
+        vector<pair<uint8_t, Node*>> children;
+    };
+
+    static const int kMaxReaders = 256;
+    struct alignas(64) ReaderSlot{
+        // Epoch the reader entered in, 0 when it is not reading
+        atomic<uint64_t> epoch{0};
+    };
+
+    atomic<Node*> m_root;
+    ReaderSlot m_slots[kMaxReaders];
+    atomic<uint64_t> m_epoch{1};
+
+    // Writer side only, protected by m_writeMutex
+    mutex m_writeMutex;
+    vector<pair<uint64_t, vector<Node*>>> m_retired;
+
+    static Node* findChild(const Node* node, uint8_t b){
+        auto it = lower_bound(node->children.begin(), node->children.end(), 
+                              make_pair(b, static_cast<Node*>(nullptr)));
+        return it != node->children.end() && it->first == b ? it->second : nullptr;
+    }
+
+    // Reader side ----------------------------------------------------------
+    class ReadGuard{
+    private:
+        ReaderSlot& m_slot;
+    public:
+        explicit ReadGuard(SnapshotTrie& trie): m_slot(trie.slot()){
+            m_slot.epoch.store(trie.m_epoch.load());
+        }
+        ~ReadGuard(){ m_slot.epoch.store(0, memory_order_release); }
+    };
+
+    ReaderSlot& slot(){
+        int id = ReaderSlotId::current();
+        if(id >= kMaxReaders)
+            throw runtime_error("SnapshotTrie: too many reader threads");
+        return m_slots[id];
+    }
+
+    const Node* walk(string_view key){
+        const Node* node = m_root.load();
+        for(char c : key)
+            if((node = findChild(node, static_cast<uint8_t>(c))) == nullptr)
+                return nullptr;
+        return node;
+    }
+
+    // Writer side ----------------------------------------------------------
+    // Applies one word to the draft rooted at root. Nodes in fresh belong to
+    // the draft and are changed in place, the others are copied and retired.
+    void insertInto(Node*& root, string_view word, unordered_set<Node*>& fresh,
+                    vector<Node*>& replaced){
+        auto own = [&](Node* node){
+            if(fresh.count(node))
+                return node;
+            Node* copy = new Node(*node);
+            fresh.insert(copy);
+            replaced.push_back(node);
+            return copy;
+        };
+        root = own(root);
+        Node* node = root;
+        for(char c : word){
+            uint8_t b = static_cast<uint8_t>(c);
+            auto& ch = node->children;
+            auto it = lower_bound(ch.begin(), ch.end(), make_pair(b, static_cast<Node*>(nullptr)));
+            if(it != ch.end() && it->first == b){
+                it->second = own(it->second);
+            }else{
+                Node* created = new Node();
+                fresh.insert(created);
+                it = ch.insert(it, make_pair(b, created));
+            }
+            node = it->second;
+        }
+        node->isEnd = true;
+    }
+
+    void publish(Node* root, vector<Node*>& replaced){
+        m_root.store(root);
+        if(!replaced.empty())
+            m_retired.emplace_back(m_epoch.load(), std::move(replaced));
+        m_epoch.fetch_add(1);
+        reclaim();
+    }
+
+    // Frees every retired batch no reader can still see
+    void reclaim(){
+        uint64_t oldest = UINT64_MAX;
+        for(auto& s : m_slots){
+            uint64_t e = s.epoch.load();
+            if(e != 0)
+                oldest = min(oldest, e);
+        }
+        auto stillVisible = [oldest](const pair<uint64_t, vector<Node*>>& batch){
+            return batch.first >= oldest;
+        };
+        auto first = stable_partition(m_retired.begin(), m_retired.end(), stillVisible);
+        for(auto it = first; it != m_retired.end(); ++it)
+            for(Node* node : it->second)
+                delete node;
+        m_retired.erase(first, m_retired.end());
+    }
+public:
+    SnapshotTrie(): m_root(new Node()){}
+    SnapshotTrie(const SnapshotTrie&) = delete;
+    SnapshotTrie& operator=(const SnapshotTrie&) = delete;
+
+    // No reader may be running any more
+    ~SnapshotTrie(){
+        vector<Node*> stack(1, m_root.load());
+        while(!stack.empty()){
+            Node* node = stack.back();
+            stack.pop_back();
+            for(auto& c : node->children)
+                stack.push_back(c.second);
+            delete node;
+        }
+        for(auto& batch : m_retired)
+            for(Node* node : batch.second)
+                delete node;
+    }
+
+    /** Returns if the word is in the trie. Lock free, any thread. */
+    bool search(string_view word){
+        ReadGuard guard(*this);
+        const Node* node = walk(word);
+        return node && node->isEnd;
+    }
+
+    /** Returns if there is any word that starts with the given prefix. Lock free, any thread. */
+    bool startsWith(string_view prefix){
+        ReadGuard guard(*this);
+        return walk(prefix) != nullptr;
+    }
+
+    /** Inserts a word and publishes the new version. */
+    void insert(string_view word){
+        insertBatch(vector<string_view>(1, word));
+    }
+
+    /** Inserts all words into one draft and publishes them together. */
+    void insertBatch(const vector<string_view>& words){
+        lock_guard<mutex> guard(m_writeMutex);
+        Node* root = m_root.load();
+        unordered_set<Node*> fresh;
+        vector<Node*> replaced;
+        for(auto w : words){
+            // Skip words already there, no need to copy their path
+            const Node* node = root;
+            for(size_t i = 0; node && i < w.size(); ++i)
+                node = findChild(node, static_cast<uint8_t>(w[i]));
+            if(!node || !node->isEnd)
+                insertInto(root, w, fresh, replaced);
+        }
+        if(root != m_root.load())
+            publish(root, replaced);
+    }
+};
+
+// Driver program: readers keep searching while the loader streams updates
+int main()
+{
+    SnapshotTrie trie;
+    trie.insert("seed");
+    atomic<bool> done(false);
+    atomic<long long> reads(0);
+
+    vector<thread> readers;
+    for(int t = 0; t < 4; ++t){
+        readers.emplace_back([&](){
+            long long n = 0;
+            while(!done.load(memory_order_relaxed)){
+                // The word is either there or not, never half inserted
+                trie.search("word1234");
+                if(!trie.search("seed"))
+                    cout << "lost a word!" << endl;
+                ++n;
+            }
+            reads += n;
+        });
+    }
+
+    for(int i = 0; i < 5000; ++i)
+        trie.insert("word" + to_string(i));
+    vector<string> batch;
+    for(int i = 5000; i < 10000; ++i)
+        batch.push_back("word" + to_string(i));
+    trie.insertBatch(vector<string_view>(batch.begin(), batch.end()));
+
+    done = true;
+    for(auto& t : readers)
+        t.join();
+    cout << trie.search("word1234") << trie.search("word9999") << trie.startsWith("word99")
+         << trie.search("word10000") << ", " << reads.load() << " reads" << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//33. string_view keys and batched Trie lookups with software prefetch
+/*
+1. string_view parameters
+Trie::insert/search/startsWith in section 9 took std::string by value, so every
+probe copied the key (and allocated for keys longer than the small string 
+buffer) before looking at a single node. They now take string_view, and so 
+do the CompactTrie (section 28), RadixTrie (29) and MappedTrie (31). 
+A string_view is a pointer and a length, it binds to std::string, literals 
+and pieces of a larger buffer (a token inside a request line) for free. We 
+replaced the parameter instead of adding a second overload: with both 
+search(string) and search(string_view), search("abc") would be ambiguous.
+
+2. searchMany(): interleaving the walks of several keys
+A single trie lookup is a chain of dependent loads: we can not know the 
+address of node i+1 before node i has arrived from memory. For a dictionary 
+much larger than the cache, each step is a cache miss (~100ns) and the CPU 
+sits idle waiting for it.
+Different keys do not depend on each other though. CompactTrie::searchMany 
+keeps 16 lookups in flight ("lanes") and advances them round robin: each 
+step reads the child index of one lane, issues __builtin_prefetch for the 
+exact slot that lane will read next, and moves on to the next lane. By the 
+time we come back to it the line is (hopefully) in L1. The memory system 
+then works on up to 16 misses at a time instead of one. A finished lane is 
+refilled with the next key right away so all lanes stay busy.
+It only pays off when the trie does not fit in cache; for a small hot trie 
+the plain loop is as fast.
+
+The driver below is the lookup throughput benchmark: 1M random keys, half 
+of them present, probed one at a time and in one searchMany() batch.
+*/
+#include <chrono>
+#include <random>
+#include <memory>
+#include <algorithm>
+using namespace std;
+
+int main()
+{
+    const size_t n = 1000000;
+    mt19937_64 rng(2024);
+    auto randomKey = [&](){
+        string k(8 + rng() % 9, 'a');
+        for(char& c : k)
+            c = char('a' + rng() % 26);
+        return k;
+    };
+
+    CompactTrie trie;
+    trie.reserve(12 * n);
+    vector<string> keys;
+    for(size_t i = 0; i < n; ++i){
+        keys.push_back(randomKey());
+        trie.insert(keys.back());
+    }
+    // Probe half present and half (almost certainly) absent keys
+    for(size_t i = 0; i < n / 2; ++i)
+        keys[i] = randomKey();
+    shuffle(keys.begin(), keys.end(), rng);
+    vector<string_view> probes(keys.begin(), keys.end());
+    cout << "Trie: " << trie.nodeCount() << " nodes, " 
+         << trie.memoryUsage() / (1 << 20) << " MB" << endl;
+
+    unique_ptr<bool[]> found(new bool[n]);
+    auto run = [&](const char* name, auto&& lookup){
+        auto start = chrono::steady_clock::now();
+        lookup();
+        chrono::duration<double> sec = chrono::steady_clock::now() - start;
+        size_t hits = count(found.get(), found.get() + n, true);
+        cout << name << n / sec.count() / 1e6 << " M lookups/s, " << hits << " hits" << endl;
+    };
+    run("search():     ", [&](){
+        for(size_t i = 0; i < n; ++i)
+            found[i] = trie.search(probes[i]);
+    });
+    run("searchMany(): ", [&](){
+        trie.searchMany(probes.data(), n, found.get());
+    });
+    return 0;
+}
+
+
+
+//*********************************************************************
+//34. Blocked Bloom filter in front of the Trie and the pair hash set
+/*
+Most Trie::search() calls (section 9) and uSet probes (section 1) in our 
+workload are for keys that are not there, and each one still walks the trie 
+or hashes into a bucket chain. A Bloom filter answers "definitely not there"
+or "maybe there" from a small bit array, so a miss usually never reaches the
+real structure.
+
+A classic Bloom filter sets k bits anywhere in the array: k cache misses per 
+probe. A blocked Bloom filter first picks one 64-byte block (one cache line)
+from the hash and sets all k bits inside that block, so any probe costs one
+cache line. We use the "split block" layout: the block is 8 64-bit words and
+each key sets exactly one bit in every word (k = 8), bit i coming from 
+(hash32 * salt[i]) >> 26. With AVX2 the 8 bit positions are computed with 
+one vector multiply and shift, and the test is two vptest instructions 
+((~block & mask) == 0); without AVX2 it is a plain 8-iteration loop.
+
+False positive rate:
+Packing the bits into one line costs some accuracy, because blocks get 
+unequal numbers of keys. With b bits per key, a block holds Poisson(512/b) 
+keys, and one of its words has a given bit set with probability 
+1 - (63/64)^x for x keys in the block, so
+    FPR(b) = sum over x of Poisson(x; 512/b) * (1 - (63/64)^x)^8
+The constructor evaluates this sum to find the smallest b that meets the 
+requested rate (about 10.25 bits per key for 1%, 15.75 for 0.1%).
+
+Parallel build, merge and serialization:
+Filters with the same number of blocks (same expected keys and rate) and the 
+same hash can be OR-ed together, so each thread builds a filter for its 
+shard and we merge them at the end. write()/read() store the block array 
+with a small header so a filter built offline can be shipped with the data.
+Keys are hashed with fixed functions (FNV-1a + splitmix64 for strings, not 
+std::hash), so the bits do not depend on the standard library. The block 
+words are written in native byte order, though: a file only reads back 
+correctly on a machine with the same endianness (every x86 and ARM server).
+
+BloomFront<Container> attaches a filter in front of a container without 
+owning it: add() records a key, contains() only calls into the container 
+(search() for the tries, count() for hash sets) when the filter says maybe.
+*/
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <utility>
+#include <unordered_set>
+#include <iostream>
+#include <sstream>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+using namespace std;
+
+// 64-bit finalizer (splitmix64), std::hash of an int is often the identity
+inline uint64_t mix64(uint64_t x){
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+// FNV-1a over the bytes, not std::hash: std::hash<string_view> differs 
+// between standard libraries (and may change between versions), and a 
+// filter written by one build must give the same bits in another
+inline uint64_t bloomHash(string_view key){
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for(char c : key){
+        h ^= static_cast<uint8_t>(c);
+        h *= 0x100000001b3ULL;
+    }
+    return mix64(h);
+}
+inline uint64_t bloomHash(const pair<int, int>& key){
+    // Both ints in one word like the Hash functor in section 1, but second
+    // goes in zero extended. Section 1 XORs in a sign extended second, so a
+    // negative second flips all the bits of first and different pairs share
+    // a word; here every pair gets its own word.
+    return mix64(((uint64_t)(uint32_t)key.first << 32) | (uint32_t)key.second);
+}
+
+// Reads count trivially copyable T into out. A corrupt count must not 
+// allocate more than the stream holds, so out grows in pieces of at most 
+// 1 MB as the data actually arrives; a short stream fails after the last 
+// piece. Also used by the readers of the later sections.
+template<typename T>
+bool readArray(istream& in, vector<T>& out, uint64_t count)
+{
+    const uint64_t piece = max<uint64_t>(1, (1 << 20) / sizeof(T));
+    out.clear();
+    while(out.size() < count){
+        size_t done = out.size();
+        size_t next = static_cast<size_t>(min<uint64_t>(count - done, piece));
+        out.resize(done + next);
+        if(!in.read(reinterpret_cast<char*>(out.data() + done), next * sizeof(T)))
+            return false;
+    }
+    return true;
+}
+
+class BlockedBloomFilter{
+private:
+    struct alignas(64) Block{
+        uint64_t words[8];
+    };
+    vector<Block> m_blocks;
+
+    static const uint32_t* salts(){
+        alignas(32) static const uint32_t s[8] = {
+            0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+            0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+        return s;
+    }
+
+    Block& blockOf(uint64_t h){
+        // Upper 32 bits pick the block (multiply-shift instead of modulo),
+        // lower 32 bits pick the bits inside it
+        return m_blocks[((h >> 32) * m_blocks.size()) >> 32];
+    }
+    const Block& blockOf(uint64_t h) const{
+        return m_blocks[((h >> 32) * m_blocks.size()) >> 32];
+    }
+
+    static double falsePositiveRate(double bitsPerKey){
+        double lambda = 512.0 / bitsPerKey;
+        double pmf = exp(-lambda), rate = 0;
+        int last = static_cast<int>(lambda + 12 * sqrt(lambda) + 20);
+        for(int x = 0; x <= last; ++x){
+            rate += pmf * pow(1 - pow(63.0 / 64.0, x), 8);
+            pmf *= lambda / (x + 1);
+        }
+        return rate;
+    }
+public:
+    BlockedBloomFilter(){}
+
+    // Sized for expectedKeys keys at the given false positive rate
+    BlockedBloomFilter(size_t expectedKeys, double fpr){
+        double bits = 4;
+        while(bits < 64 && falsePositiveRate(bits) > fpr)
+            bits += 0.25;
+        size_t blocks = static_cast<size_t>(ceil(expectedKeys * bits / 512));
+        m_blocks.assign(blocks > 0 ? blocks : 1, Block());
+    }
+
+    size_t sizeInBytes() const { return m_blocks.size() * sizeof(Block); }
+
+    void add(uint64_t h){
+        Block& block = blockOf(h);
+        uint32_t h32 = static_cast<uint32_t>(h);
+#ifdef __AVX2__
+        __m256i bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(h32),
+                          _mm256_load_si256(reinterpret_cast<const __m256i*>(salts()))), 26);
+        __m256i one = _mm256_set1_epi64x(1);
+        __m256i lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bits)));
+        __m256i hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bits, 1)));
+        __m256i* w = reinterpret_cast<__m256i*>(block.words);
+        _mm256_store_si256(w, _mm256_or_si256(_mm256_load_si256(w), lo));
+        _mm256_store_si256(w + 1, _mm256_or_si256(_mm256_load_si256(w + 1), hi));
+#else
+        for(int i = 0; i < 8; ++i)
+            block.words[i] |= 1ULL << ((h32 * salts()[i]) >> 26);
+#endif
+    }
+
+    // false: definitely absent, true: maybe present
+    bool mayContain(uint64_t h) const{
+        const Block& block = blockOf(h);
+        uint32_t h32 = static_cast<uint32_t>(h);
+#ifdef __AVX2__
+        __m256i bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(h32),
+                          _mm256_load_si256(reinterpret_cast<const __m256i*>(salts()))), 26);
+        __m256i one = _mm256_set1_epi64x(1);
+        __m256i lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bits)));
+        __m256i hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bits, 1)));
+        const __m256i* w = reinterpret_cast<const __m256i*>(block.words);
+        // testc(a, b) is 1 when every bit of b is also set in a
+        return _mm256_testc_si256(_mm256_load_si256(w), lo) 
+             & _mm256_testc_si256(_mm256_load_si256(w + 1), hi);
+#else
+        for(int i = 0; i < 8; ++i)
+            if(!(block.words[i] & (1ULL << ((h32 * salts()[i]) >> 26))))
+                return false;
+        return true;
+#endif
+    }
+
+    // Union with a filter of the same size, false if the sizes differ
+    bool merge(const BlockedBloomFilter& other){
+        if(other.m_blocks.size() != m_blocks.size())
+            return false;
+        for(size_t b = 0; b < m_blocks.size(); ++b)
+            for(int i = 0; i < 8; ++i)
+                m_blocks[b].words[i] |= other.m_blocks[b].words[i];
+        return true;
+    }
+
+    void write(ostream& out) const{
+        uint64_t blocks = m_blocks.size();
+        out.write("BLOOMBF1", 8);
+        out.write(reinterpret_cast<const char*>(&blocks), sizeof(blocks));
+        out.write(reinterpret_cast<const char*>(m_blocks.data()), sizeInBytes());
+    }
+
+    // Returns false (and leaves the filter unchanged) on a bad stream
+    bool read(istream& in){
+        char magic[8];
+        uint64_t blocks = 0;
+        if(!in.read(magic, 8) || memcmp(magic, "BLOOMBF1", 8) != 0
+           || !in.read(reinterpret_cast<char*>(&blocks), sizeof(blocks)) || blocks == 0)
+            return false;
+        vector<Block> loaded;
+        if(!readArray(in, loaded, blocks))
+            return false;
+        m_blocks.swap(loaded);
+        return true;
+    }
+};
+
+// Filter in front of a container it does not own
+template<typename Container>
+class BloomFront{
+private:
+    Container& m_inner;
+    BlockedBloomFilter m_filter;
+
+    // search() for the tries, count() for the hash sets
+    template<typename C, typename Key>
+    static auto probe(C& c, const Key& key, int) -> decltype(bool(c.search(key))){
+        return c.search(key);
+    }
+    template<typename C, typename Key>
+    static auto probe(C& c, const Key& key, long) -> decltype(bool(c.count(key))){
+        return c.count(key) > 0;
+    }
+public:
+    BloomFront(Container& inner, size_t expectedKeys, double fpr):
+        m_inner(inner), m_filter(expectedKeys, fpr){}
+
+    // Call for every key inserted into the container
+    template<typename Key>
+    void add(const Key& key){ m_filter.add(bloomHash(key)); }
+
+    template<typename Key>
+    bool contains(const Key& key){
+        return m_filter.mayContain(bloomHash(key)) && probe(m_inner, key, 0);
+    }
+
+    BlockedBloomFilter& filter(){ return m_filter; }
+};
+
+// Driver program to test above classes
+int main()
+{
+    // Pair hash set of section 1 with a filter in front of it
+    unordered_set<pair<int, int>, Hash> uSet;
+    BloomFront<unordered_set<pair<int, int>, Hash>> pairs(uSet, 100000, 0.01);
+    for(int i = 0; i < 100000; ++i){
+        uSet.insert({i, i * 7});
+        pairs.add(make_pair(i, i * 7));
+    }
+    int falsePositives = 0;
+    for(int i = 0; i < 100000; ++i)
+        falsePositives += pairs.filter().mayContain(bloomHash(make_pair(i, i * 7 + 1)));
+    cout << "pair filter: " << pairs.contains(make_pair(42, 294)) << pairs.contains(make_pair(42, 295))
+         << ", false positive rate " << falsePositives / 100000.0 << endl;
+
+    // Build one filter per thread over a shard of the words, then merge.
+    // The words are spelled with letters only so the 26-ary trie takes them.
+    vector<string> words;
+    for(int i = 0; i < 200000; ++i){
+        string w = "word";
+        for(int x = i; x > 0; x /= 26)
+            w += char('a' + x % 26);
+        words.push_back(w);
+    }
+    const int shards = 4;
+    vector<BlockedBloomFilter> parts(shards, BlockedBloomFilter(words.size(), 0.001));
+    vector<thread> threads;
+    for(int t = 0; t < shards; ++t)
+        threads.emplace_back([&, t](){
+            for(size_t i = t; i < words.size(); i += shards)
+                parts[t].add(bloomHash(words[i]));
+        });
+    for(auto& t : threads)
+        t.join();
+    for(int t = 1; t < shards; ++t)
+        parts[0].merge(parts[t]);
+
+    // Ship it through serialization and put it in front of a trie
+    stringstream buffer;
+    parts[0].write(buffer);
+    CompactTrie trie;
+    for(auto& w : words)
+        trie.insert(w);
+    BloomFront<CompactTrie> dictionary(trie, words.size(), 0.001);
+    dictionary.filter().read(buffer);
+    cout << "trie filter: " << dictionary.contains(string_view("wordxyz")) 
+         << dictionary.contains(string_view("missing")) << ", " 
+         << dictionary.filter().sizeInBytes() / double(words.size()) * 8 << " bits per key" << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//35. Iterative union find with union by size
+/*
+Problems with the union find in sections 11 and 17:
+1. find() is recursive, one stack frame per node on the path. Union by rank 
+keeps paths at O(Logn), but as soon as parents get linked any other way 
+(e.g. parent[x] = y on non-roots, or a union without the rank check) a path 
+can be as long as the number of vertices, and the recursion overflows the 
+stack for a few million vertices. A loop does not care.
+2. isCycle() mallocs its subsets and KruskalMST() news them, neither frees.
+3. An array of {parent, rank} structs per query, rebuilt from scratch.
+
+DisjointSet below:
+- find() with path halving: every node on the path is pointed to its 
+grandparent while we walk up. It is a plain loop (no stack), needs one pass 
+instead of two, and gives the same amortized bound as full path compression:
+O(alpha(n)) per operation together with union by size.
+- Union by size: attach the smaller tree under the larger one. Same bound as 
+union by rank, and the size of a set comes for free.
+- SoA layout: parent[] and size[] are separate contiguous arrays of Index 
+(32-bit by default), find() only touches parent[].
+- reset(n) reinitializes for the next query and keeps the allocation.
+*/
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+template<typename Index = uint32_t>
+class DisjointSet{
+private:
+    vector<Index> m_parent;
+    vector<Index> m_size;
+    size_t m_sets;
+public:
+    explicit DisjointSet(size_t n = 0){ reset(n); }
+
+    // n singleton sets, reuses the arrays of the previous query
+    void reset(size_t n){
+        m_parent.resize(n);
+        iota(m_parent.begin(), m_parent.end(), Index(0));
+        m_size.assign(n, Index(1));
+        m_sets = n;
+    }
+
+    // Root of x, with path halving
+    Index find(Index x){
+        while(m_parent[x] != x){
+            m_parent[x] = m_parent[m_parent[x]];
+            x = m_parent[x];
+        }
+        return x;
+    }
+
+    // Merges the sets of a and b, false if they were already one set
+    bool unite(Index a, Index b){
+        a = find(a);
+        b = find(b);
+        if(a == b)
+            return false;
+        if(m_size[a] < m_size[b])
+            swap(a, b);
+        m_parent[b] = a;
+        m_size[a] += m_size[b];
+        --m_sets;
+        return true;
+    }
+
+    // Root of x without path halving. Read only, so several threads may 
+    // call it at the same time as long as nobody calls unite() or find().
+    Index root(Index x) const{
+        while(m_parent[x] != x)
+            x = m_parent[x];
+        return x;
+    }
+
+    bool connected(Index a, Index b){ return find(a) == find(b); }
+    Index setSize(Index x){ return m_size[find(x)]; }
+    size_t sets() const { return m_sets; }
+    size_t size() const { return m_parent.size(); }
+};
+
+// The isCycle() of section 11 on top of DisjointSet. dsu is passed in so a
+// caller answering many queries keeps one allocation.
+bool isCycle(size_t V, const vector<pair<uint32_t, uint32_t>>& edges, 
+             DisjointSet<>& dsu)
+{
+    dsu.reset(V);
+    for(auto& e : edges)
+        if(!dsu.unite(e.first, e.second))
+            return true;
+    return false;
+}
+
+// Component id of every vertex, numbered 0.. in order of the smallest vertex
+vector<uint32_t> connectedComponents(size_t V, const vector<pair<uint32_t, uint32_t>>& edges,
+                                     DisjointSet<>& dsu)
+{
+    dsu.reset(V);
+    for(auto& e : edges)
+        dsu.unite(e.first, e.second);
+    const uint32_t none = UINT32_MAX;
+    vector<uint32_t> rootLabel(V, none), label(V);
+    uint32_t next = 0;
+    for(uint32_t v = 0; v < V; ++v){
+        uint32_t root = dsu.find(v);
+        if(rootLabel[root] == none)
+            rootLabel[root] = next++;
+        label[v] = rootLabel[root];
+    }
+    return label;
+}
+
+// Driver program to test above functions
+int main()
+{
+    DisjointSet<> dsu;
+    // The triangle of section 11
+    vector<pair<uint32_t, uint32_t>> triangle = {{0, 1}, {1, 2}, {0, 2}};
+    cout << (isCycle(3, triangle, dsu) ? "Graph contains cycle" 
+                                       : "Graph doesn't contain cycle") << endl;
+
+    // 10M vertices: nothing here recurses, only memory limits the size
+    const uint32_t n = 10000000;
+    vector<pair<uint32_t, uint32_t>> chain;
+    for(uint32_t v = 1; v < n; ++v)
+        chain.push_back({v, v - 1});
+    cout << (isCycle(n, chain, dsu) ? "chain has a cycle" : "chain is a tree") << endl;
+
+    vector<pair<uint32_t, uint32_t>> edges = {{0, 1}, {2, 3}, {3, 4}};
+    vector<uint32_t> label = connectedComponents(6, edges, dsu);
+    for(uint32_t l : label)
+        cout << l << " ";
+    cout << "(" << dsu.sets() << " components)" << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//36. Lock-free concurrent union find and parallel connected components
+/*
+isCycle() (section 11) and the union find in Kruskal (section 17) process 
+the edges one at a time on one core. For billions of edges we want all cores
+to call unite() on the same structure at the same time, without a lock.
+
+Lock-free union find (Anderson & Woll, Jayanti & Tarjan):
+1. parent[] is an array of atomic 32-bit indices.
+2. Link by index: when two roots meet, the larger index always goes under the
+smaller one. Every parent pointer then points to a smaller index, so no 
+interleaving can ever create a cycle, and the root of a component is always
+its smallest vertex no matter in which order the threads ran.
+3. unite(a, b) finds both roots and links with a single CAS on the parent of
+the larger root, expecting it to still be a root. If another thread linked 
+that root first the CAS fails, and we simply find the new roots and retry.
+4. find() uses path splitting: every node on the path is swung to its 
+grandparent with a CAS. The CAS may fail because somebody else already 
+shortened the pointer, that is fine: the pointer only ever moves to another
+ancestor (a smaller index), so the tree stays valid either way.
+No thread ever waits for another one: some thread's CAS always succeeds, so
+the structure is lock-free.
+
+Parallel connected components:
+Split the edge list into one contiguous shard per thread and let each thread
+unite() its edges. Then every vertex finds its root (its component's 
+smallest vertex) in parallel, and components are numbered in order of their
+smallest vertex. That is exactly the numbering connectedComponents() of 
+section 35 returns, so the results can be compared element by element.
+
+parallelFor() below is the small helper the parallel sections after this one
+use as well: it splits [0, n) into one contiguous chunk per thread.
+*/
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+using namespace std;
+
+// Runs body(begin, end, t) for thread t on its chunk of [0, n). threads == 0
+// means one thread per hardware thread. The calling thread runs chunk 0.
+template<typename F>
+void parallelFor(size_t n, unsigned threads, F&& body)
+{
+    if(threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+    if(threads > n)
+        threads = static_cast<unsigned>(max<size_t>(n, 1));
+    size_t chunk = (n + threads - 1) / threads;
+    vector<thread> workers;
+    for(unsigned t = 1; t < threads; ++t)
+        workers.emplace_back([&, t](){
+            body(min(n, t * chunk), min(n, (t + 1) * chunk), t);
+        });
+    body(0, min(n, chunk), 0u);
+    for(auto& w : workers)
+        w.join();
+}
+
+class ConcurrentDisjointSet{
+private:
+    vector<atomic<uint32_t>> m_parent;
+public:
+    explicit ConcurrentDisjointSet(size_t n): m_parent(n){
+        for(uint32_t v = 0; v < n; ++v)
+            m_parent[v].store(v, memory_order_relaxed);
+    }
+
+    // Root of x, with path splitting. Safe to call from any thread.
+    uint32_t find(uint32_t x){
+        for(;;){
+            uint32_t p = m_parent[x].load(memory_order_acquire);
+            if(p == x)
+                return x;
+            uint32_t gp = m_parent[p].load(memory_order_acquire);
+            if(p != gp)
+                m_parent[x].compare_exchange_weak(p, gp, memory_order_acq_rel,
+                                                  memory_order_relaxed);
+            x = p;
+        }
+    }
+
+    // Merges the sets of a and b, false if they already were one set
+    bool unite(uint32_t a, uint32_t b){
+        for(;;){
+            a = find(a);
+            b = find(b);
+            if(a == b)
+                return false;
+            // Link by index: the larger root goes under the smaller one
+            if(a < b)
+                swap(a, b);
+            uint32_t expected = a;
+            if(m_parent[a].compare_exchange_strong(expected, b, memory_order_acq_rel,
+                                                   memory_order_relaxed))
+                return true;
+            // a stopped being a root in the meantime, try again
+        }
+    }
+
+    // Linearizable: if the roots differ, we only answer "no" while a is 
+    // still a root, otherwise a concurrent unite() may have joined them
+    bool connected(uint32_t a, uint32_t b){
+        for(;;){
+            a = find(a);
+            b = find(b);
+            if(a == b)
+                return true;
+            if(m_parent[a].load(memory_order_acquire) == a)
+                return false;
+        }
+    }
+
+    size_t size() const { return m_parent.size(); }
+};
+
+// Same output as connectedComponents() in section 35
+vector<uint32_t> parallelConnectedComponents(size_t V, 
+        const vector<pair<uint32_t, uint32_t>>& edges, unsigned threads = 0)
+{
+    ConcurrentDisjointSet dsu(V);
+    parallelFor(edges.size(), threads, [&](size_t begin, size_t end, unsigned){
+        for(size_t i = begin; i < end; ++i)
+            dsu.unite(edges[i].first, edges[i].second);
+    });
+
+    // No unite() runs any more, so every root is final
+    vector<uint32_t> label(V);
+    parallelFor(V, threads, [&](size_t begin, size_t end, unsigned){
+        for(size_t v = begin; v < end; ++v)
+            label[v] = dsu.find(static_cast<uint32_t>(v));
+    });
+    // Roots are the smallest vertex of their component, so numbering them 
+    // in vertex order numbers components by their smallest vertex
+    vector<uint32_t> rootId(V);
+    uint32_t next = 0;
+    for(uint32_t v = 0; v < V; ++v)
+        if(label[v] == v)
+            rootId[v] = next++;
+    parallelFor(V, threads, [&](size_t begin, size_t end, unsigned){
+        for(size_t v = begin; v < end; ++v)
+            label[v] = rootId[label[v]];
+    });
+    return label;
+}
+
+// Driver program: random sparse graph, parallel vs sequential (section 35)
+int main()
+{
+    const uint32_t V = 2000000;
+    const size_t E = 1500000;
+    mt19937_64 rng(7);
+    vector<pair<uint32_t, uint32_t>> edges(E);
+    for(auto& e : edges)
+        e = make_pair(uint32_t(rng() % V), uint32_t(rng() % V));
+
+    auto start = chrono::steady_clock::now();
+    DisjointSet<> dsu;
+    vector<uint32_t> expected = connectedComponents(V, edges, dsu);
+    chrono::duration<double> seqTime = chrono::steady_clock::now() - start;
+
+    unsigned cores = max(1u, thread::hardware_concurrency());
+    for(unsigned threads = 1; threads <= max(cores, 4u); threads *= 2){
+        start = chrono::steady_clock::now();
+        vector<uint32_t> label = parallelConnectedComponents(V, edges, threads);
+        chrono::duration<double> parTime = chrono::steady_clock::now() - start;
+        cout << threads << " threads: " << parTime.count() << "s (sequential " 
+             << seqTime.count() << "s), " << (label == expected ? "same" : "DIFFERENT")
+             << " components" << endl;
+    }
+    return 0;
+}
+
+
+
+//*********************************************************************
+//37. Union find with rollback and offline dynamic connectivity
+/*
+The find()/Union() pair of sections 11 and 17 can only merge sets. Path 
+compression rewrites parent pointers all over the tree, so there is no cheap
+way to undo a union, and we need undo to handle edges being removed again.
+
+Union find with rollback:
+1. Union by rank, NO path compression. Rank alone keeps trees O(Logn) deep, 
+so find() is O(Logn).
+2. A union changes exactly two things: the parent of one root and maybe the 
+rank of the other. We push both onto an undo stack.
+3. snapshot() returns the stack height, rollback(h) pops and reverts unions 
+until the stack is back at height h. Each undo is O(1).
+
+Offline dynamic connectivity (segment tree over time):
+We get the whole timeline up front: "add edge", "remove edge" and "are u 
+and v connected" operations, one per time step 0..T-1. Every edge is alive 
+during an interval [added, removed) of time steps.
+1. Build a segment tree over [0, T). Like a range update in the segment tree 
+of section 8, an interval is stored in the O(LogT) nodes that exactly cover 
+it.
+2. DFS the segment tree. Entering a node, unite() the edges stored there; at 
+a leaf t, all edges alive at time t are united, so a query at t is one 
+connected() check; leaving the node, rollback() to the snapshot we took when
+entering. Every edge is united and undone O(LogT) times.
+Total: O((n + q) LogT * Logn), i.e. O((n + q) Log^2 n).
+*/
+#include <cstdint>
+#include <map>
+#include <numeric>
+#include <utility>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+class RollbackDisjointSet{
+private:
+    vector<uint32_t> m_parent;
+    vector<uint8_t> m_rank;
+    // One entry per successful unite(): the root that was attached, and 
+    // whether the rank of its new parent went up
+    struct Change{ uint32_t child; bool rankUp; };
+    vector<Change> m_history;
+    size_t m_sets;
+public:
+    explicit RollbackDisjointSet(size_t n): m_parent(n), m_rank(n, 0), m_sets(n){
+        iota(m_parent.begin(), m_parent.end(), 0u);
+    }
+
+    // No path compression, it could not be undone
+    uint32_t find(uint32_t x) const{
+        while(m_parent[x] != x)
+            x = m_parent[x];
+        return x;
+    }
+
+    bool unite(uint32_t a, uint32_t b){
+        a = find(a);
+        b = find(b);
+        if(a == b)
+            return false;
+        if(m_rank[a] < m_rank[b])
+            swap(a, b);
+        bool rankUp = m_rank[a] == m_rank[b];
+        m_parent[b] = a;
+        m_rank[a] += rankUp;
+        m_history.push_back(Change{b, rankUp});
+        --m_sets;
+        return true;
+    }
+
+    bool connected(uint32_t a, uint32_t b) const{ return find(a) == find(b); }
+    size_t sets() const { return m_sets; }
+
+    size_t snapshot() const { return m_history.size(); }
+
+    // Undoes every unite() done after snapshot() returned height
+    void rollback(size_t height){
+        while(m_history.size() > height){
+            Change c = m_history.back();
+            m_history.pop_back();
+            uint32_t root = m_parent[c.child];
+            m_rank[root] -= c.rankUp;
+            m_parent[c.child] = c.child;
+            ++m_sets;
+        }
+    }
+};
+
+class OfflineDynamicConnectivity{
+private:
+    size_t m_vertices;
+    // One time step per operation, queries remember their step
+    size_t m_time;
+    vector<pair<uint32_t, uint32_t>> m_queries;
+    vector<size_t> m_queryTime;
+    // Edge (u < v) -> times it was added and is not removed yet
+    map<pair<uint32_t, uint32_t>, vector<size_t>> m_open;
+    struct Interval{ size_t from, to; uint32_t u, v; };
+    vector<Interval> m_intervals;
+
+    // Stores edge (u, v) in the nodes covering [from, to), like section 8
+    void cover(vector<vector<pair<uint32_t, uint32_t>>>& tree, size_t node, 
+               size_t lo, size_t hi, const Interval& e){
+        if(e.to <= lo || hi <= e.from)
+            return;
+        if(e.from <= lo && hi <= e.to){
+            tree[node].emplace_back(e.u, e.v);
+            return;
+        }
+        size_t mid = lo + (hi - lo) / 2;
+        cover(tree, 2 * node, lo, mid, e);
+        cover(tree, 2 * node + 1, mid, hi, e);
+    }
+
+    // Recursion depth is only LogT
+    void dfs(const vector<vector<pair<uint32_t, uint32_t>>>& tree, size_t node,
+             size_t lo, size_t hi, RollbackDisjointSet& dsu,
+             const vector<int>& queryAt, vector<bool>& answers){
+        size_t height = dsu.snapshot();
+        for(auto& e : tree[node])
+            dsu.unite(e.first, e.second);
+        if(hi - lo == 1){
+            if(queryAt[lo] >= 0){
+                auto& q = m_queries[queryAt[lo]];
+                answers[queryAt[lo]] = dsu.connected(q.first, q.second);
+            }
+        }else{
+            size_t mid = lo + (hi - lo) / 2;
+            dfs(tree, 2 * node, lo, mid, dsu, queryAt, answers);
+            dfs(tree, 2 * node + 1, mid, hi, dsu, queryAt, answers);
+        }
+        dsu.rollback(height);
+    }
+
+    static pair<uint32_t, uint32_t> key(uint32_t u, uint32_t v){
+        return u < v ? make_pair(u, v) : make_pair(v, u);
+    }
+public:
+    explicit OfflineDynamicConnectivity(size_t V): m_vertices(V), m_time(0){}
+
+    void addEdge(uint32_t u, uint32_t v){
+        m_open[key(u, v)].push_back(m_time++);
+    }
+
+    // Removes one copy of the edge, ignored if there is none
+    void removeEdge(uint32_t u, uint32_t v){
+        auto it = m_open.find(key(u, v));
+        if(it != m_open.end() && !it->second.empty()){
+            m_intervals.push_back(Interval{it->second.back(), m_time, it->first.first, 
+                                           it->first.second});
+            it->second.pop_back();
+        }
+        ++m_time;
+    }
+
+    // Returns the index of this query in the result of solve()
+    size_t query(uint32_t u, uint32_t v){
+        m_queries.emplace_back(u, v);
+        m_queryTime.push_back(m_time++);
+        return m_queries.size() - 1;
+    }
+
+    // answers[i] is true if the endpoints of query i were connected at its time
+    vector<bool> solve(){
+        vector<bool> answers(m_queries.size(), false);
+        if(m_time == 0)
+            return answers;
+        // Edges never removed live until the end of the timeline
+        vector<Interval> intervals = m_intervals;
+        for(auto& open : m_open)
+            for(size_t from : open.second)
+                intervals.push_back(Interval{from, m_time, open.first.first, open.first.second});
+
+        vector<vector<pair<uint32_t, uint32_t>>> tree(4 * m_time);
+        for(auto& e : intervals)
+            cover(tree, 1, 0, m_time, e);
+        vector<int> queryAt(m_time, -1);
+        for(size_t i = 0; i < m_queryTime.size(); ++i)
+            queryAt[m_queryTime[i]] = static_cast<int>(i);
+
+        RollbackDisjointSet dsu(m_vertices);
+        dfs(tree, 1, 0, m_time, dsu, queryAt, answers);
+        return answers;
+    }
+};
+
+// Driver program to test above classes
+int main()
+{
+    OfflineDynamicConnectivity timeline(4);
+    timeline.addEdge(0, 1);
+    timeline.addEdge(1, 2);
+    size_t q0 = timeline.query(0, 2);   // connected through 1
+    timeline.removeEdge(1, 0);
+    size_t q1 = timeline.query(0, 2);   // not any more
+    timeline.addEdge(0, 3);
+    timeline.addEdge(3, 2);
+    size_t q2 = timeline.query(0, 2);   // through 3
+    timeline.removeEdge(2, 3);
+    size_t q3 = timeline.query(2, 1);   // edge 1-2 is still there
+
+    vector<bool> answers = timeline.solve();
+    cout << answers[q0] << answers[q1] << answers[q2] << answers[q3] << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//38. MST engine: radix sorted Kruskal, Filter-Kruskal and parallel Boruvka
+/*
+KruskalMST() in section 17 had two bugs (both fixed there now): myComp() 
+returned "a > b" (0 or 1) to qsort(), which needs negative/zero/positive, so
+the edges were not reliably sorted; and "Edge result[V]" is a VLA on the 
+stack, which is not standard C++ and overflows for large graphs. It is also 
+O(ElogE) comparison sorting on one core, before the first union.
+
+The engine below returns the minimum spanning forest as a heap allocated 
+vector of edges (one tree per connected component), in one of three modes:
+
+1. Kruskal: LSD radix sort of the edges by integer weight, then the usual 
+scan with DisjointSet (section 35). The weight is a 32-bit key (sign bit 
+flipped so negative weights sort first); each 8-bit digit is one counting 
+pass: every thread counts its chunk, a prefix sum over (digit, thread) gives
+every thread its output positions, and every thread scatters its chunk. 
+That is stable, and a pass whose digit is the same for all edges is skipped.
+O(E) work instead of O(ElogE).
+
+2. Filter-Kruskal (Osipov, Sanders, Singler): most edges of a dense graph 
+are heavy ones that Kruskal only looks at to throw them away. Pick a pivot 
+weight, split the edges into light (<= pivot) and heavy (> pivot), solve the
+light part recursively, then drop every heavy edge whose endpoints are 
+already connected before recursing on the rest. Small parts are radix 
+sorted and scanned like mode 1. The split and the filter are parallel 
+stable partitions (count per chunk, then scatter per chunk). Filtering 
+uses DisjointSet::root(), the read-only find, so threads can share it.
+
+3. Boruvka, for very large graphs: in every round each component picks its 
+cheapest outgoing edge, and all of those are added at once. The number of 
+components at least halves per round, so there are O(LogV) rounds. Every 
+step of a round is parallel: a pass over the live edges does an atomic min 
+on the best edge of both endpoint components, the components then hook 
+along their edges with unite() of the lock-free union find of section 36, 
+and a parallel stable partition drops the edges that lay inside one 
+component when the round started (found by the first pass, no extra find) 
+once there are enough of them to pay for the copy. Only the components 
+that still have live edges are visited, so a round costs O(live edges + 
+live components), not O(V).
+The best edge of a component is one 64-bit word, (weight << 32) | position,
+so Boruvka handles at most 2^32 - 1 edges. A larger input falls back to 
+Filter-Kruskal (mode 2), which is parallel too and has no such limit.
+
+All three modes break ties between equal weights by position in the input,
+so the order (weight, index) is a strict total order and the MST is unique: 
+every mode returns exactly the same set of edges.
+*/
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <iostream>
+using namespace std;
+
+struct WeightedEdge{
+    uint32_t src, dest;
+    int32_t weight;
+};
+
+// Order preserving map of a signed weight to an unsigned key
+inline uint32_t weightKey(int32_t w){
+    return static_cast<uint32_t>(w) ^ 0x80000000u;
+}
+
+// Stable parallel partition: out gets the edges with pred() true first, then
+// the others, both in input order. Returns the number of pred() true edges.
+template<typename Pred>
+size_t parallelStablePartition(const vector<WeightedEdge>& in, vector<WeightedEdge>& out,
+                               Pred pred, unsigned threads)
+{
+    size_t n = in.size();
+    if(threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+    vector<size_t> yes(threads, 0), no(threads, 0);
+    vector<uint8_t> flag(n);
+    parallelFor(n, threads, [&](size_t begin, size_t end, unsigned t){
+        for(size_t i = begin; i < end; ++i)
+            if((flag[i] = pred(in[i])) != 0)
+                ++yes[t];
+            else
+                ++no[t];
+    });
+    size_t total = accumulate(yes.begin(), yes.end(), size_t(0));
+    for(size_t t = 0, y = 0, o = total; t < threads; ++t){
+        size_t cy = yes[t], co = no[t];
+        yes[t] = y; no[t] = o;
+        y += cy; o += co;
+    }
+    out.resize(n);
+    parallelFor(n, threads, [&](size_t begin, size_t end, unsigned t){
+        for(size_t i = begin; i < end; ++i)
+            out[flag[i] ? yes[t]++ : no[t]++] = in[i];
+    });
+    return total;
+}
+
+// Stable LSD radix sort by weight, 8 bits per pass
+void radixSortByWeight(vector<WeightedEdge>& edges, unsigned threads = 0)
+{
+    const int kBuckets = 256;
+    size_t n = edges.size();
+    if(threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+    // Not worth waking threads for small inputs
+    if(n < (1 << 16))
+        threads = 1;
+    vector<WeightedEdge> buffer(n);
+    vector<size_t> counts(size_t(threads) * kBuckets);
+    for(int shift = 0; shift < 32; shift += 8){
+        fill(counts.begin(), counts.end(), 0);
+        parallelFor(n, threads, [&](size_t begin, size_t end, unsigned t){
+            size_t* c = &counts[size_t(t) * kBuckets];
+            for(size_t i = begin; i < end; ++i)
+                ++c[(weightKey(edges[i].weight) >> shift) & 255];
+        });
+        // Skip the pass if every edge has the same digit
+        bool trivial = false;
+        for(int d = 0; d < kBuckets && !trivial; ++d){
+            size_t inDigit = 0;
+            for(unsigned t = 0; t < threads; ++t)
+                inDigit += counts[size_t(t) * kBuckets + d];
+            trivial = inDigit == n;
+        }
+        if(trivial)
+            continue;
+        // Exclusive prefix sum in (digit, thread) order keeps it stable
+        size_t sum = 0;
+        for(int d = 0; d < kBuckets; ++d)
+            for(unsigned t = 0; t < threads; ++t){
+                size_t c = counts[size_t(t) * kBuckets + d];
+                counts[size_t(t) * kBuckets + d] = sum;
+                sum += c;
+            }
+        parallelFor(n, threads, [&](size_t begin, size_t end, unsigned t){
+            size_t* c = &counts[size_t(t) * kBuckets];
+            for(size_t i = begin; i < end; ++i)
+                buffer[c[(weightKey(edges[i].weight) >> shift) & 255]++] = edges[i];
+        });
+        edges.swap(buffer);
+    }
+}
+
+enum class MstMode { Kruskal, FilterKruskal, Boruvka };
+
+class MstEngine{
+private:
+    size_t m_vertices;
+    unsigned m_threads;
+    DisjointSet<> m_dsu;
+    vector<WeightedEdge> m_result;
+
+    bool done() const { return m_result.size() + 1 >= m_vertices; }
+
+    void kruskalSorted(const vector<WeightedEdge>& sorted){
+        for(size_t i = 0; i < sorted.size() && !done(); ++i)
+            if(m_dsu.unite(sorted[i].src, sorted[i].dest))
+                m_result.push_back(sorted[i]);
+    }
+
+    void filterKruskal(vector<WeightedEdge>& edges){
+        const size_t kBaseCase = 1 << 14;
+        if(done() || edges.empty())
+            return;
+        if(edges.size() <= kBaseCase){
+            radixSortByWeight(edges, 1);
+            kruskalSorted(edges);
+            return;
+        }
+        // Median of a small sample as the pivot. Deterministic, so a run 
+        // can be reproduced.
+        mt19937 rng(static_cast<uint32_t>(edges.size()));
+        vector<int32_t> sample(31);
+        for(auto& w : sample)
+            w = edges[rng() % edges.size()].weight;
+        nth_element(sample.begin(), sample.begin() + 15, sample.end());
+        int32_t pivot = sample[15];
+
+        vector<WeightedEdge> split;
+        size_t light = parallelStablePartition(edges, split, 
+            [pivot](const WeightedEdge& e){ return e.weight <= pivot; }, m_threads);
+        vector<WeightedEdge>().swap(edges);
+        if(light == split.size()){
+            // Everything is <= pivot (e.g. all weights equal), no progress
+            // from splitting again
+            radixSortByWeight(split, m_threads);
+            kruskalSorted(split);
+            return;
+        }
+        vector<WeightedEdge> lightEdges(split.begin(), split.begin() + light);
+        vector<WeightedEdge> heavyEdges(split.begin() + light, split.end());
+        vector<WeightedEdge>().swap(split);
+
+        filterKruskal(lightEdges);
+        if(done())
+            return;
+        vector<WeightedEdge> kept;
+        size_t useful = parallelStablePartition(heavyEdges, kept, 
+            [this](const WeightedEdge& e){ return m_dsu.root(e.src) != m_dsu.root(e.dest); },
+            m_threads);
+        kept.resize(useful);
+        vector<WeightedEdge>().swap(heavyEdges);
+        filterKruskal(kept);
+    }
+
+    void boruvka(vector<WeightedEdge>& live){
+        const uint64_t none = UINT64_MAX;
+        // Hooking runs in parallel, so this round's unions go to the lock 
+        // free union find of section 36
+        ConcurrentDisjointSet dsu(m_vertices);
+        vector<atomic<uint64_t>> best(m_vertices);
+        // Roots of the components that still have a live edge
+        vector<uint32_t> roots(m_vertices);
+        iota(roots.begin(), roots.end(), 0u);
+        vector<vector<WeightedEdge>> picked(m_threads);
+        vector<vector<uint32_t>> survivors(m_threads);
+        vector<uint8_t> crossing;
+        vector<size_t> internal(m_threads);
+
+        while(!live.empty() && !done()){
+            parallelFor(roots.size(), m_threads, [&](size_t begin, size_t end, unsigned){
+                for(size_t i = begin; i < end; ++i)
+                    best[roots[i]].store(none, memory_order_relaxed);
+            });
+            // (weight, position) packed into one word, so one atomic min
+            // picks the cheapest edge with ties broken by position. Live 
+            // edges stay in input order, so that is the input order too.
+            auto atomicMin = [](atomic<uint64_t>& slot, uint64_t value){
+                uint64_t cur = slot.load(memory_order_relaxed);
+                while(value < cur && !slot.compare_exchange_weak(cur, value, 
+                                                                 memory_order_relaxed));
+            };
+            crossing.resize(live.size());
+            fill(internal.begin(), internal.end(), 0);
+            parallelFor(live.size(), m_threads, [&](size_t begin, size_t end, unsigned t){
+                size_t inside = 0;
+                for(size_t i = begin; i < end; ++i){
+                    uint32_t cu = dsu.find(live[i].src), cv = dsu.find(live[i].dest);
+                    crossing[i] = cu != cv;
+                    if(cu == cv){
+                        ++inside;
+                        continue;
+                    }
+                    uint64_t key = (uint64_t(weightKey(live[i].weight)) << 32) | i;
+                    atomicMin(best[cu], key);
+                    atomicMin(best[cv], key);
+                }
+                internal[t] = inside;
+            });
+            // Every component hooks along its edge. Two components that 
+            // picked the same edge leave it to the smaller root, so each edge 
+            // is added once. Nothing is united while the edges are picked, 
+            // so find() still returns this round's roots.
+            parallelFor(roots.size(), m_threads, [&](size_t begin, size_t end, unsigned t){
+                for(size_t i = begin; i < end; ++i){
+                    uint32_t c = roots[i];
+                    uint64_t key = best[c].load(memory_order_relaxed);
+                    if(key == none)
+                        continue;
+                    const WeightedEdge& e = live[static_cast<uint32_t>(key)];
+                    uint32_t cu = dsu.find(e.src);
+                    uint32_t other = cu == c ? dsu.find(e.dest) : cu;
+                    if(other < c && best[other].load(memory_order_relaxed) == key)
+                        continue;
+                    picked[t].push_back(e);
+                }
+            });
+            // The picked edges form a forest, so the unions are independent
+            parallelFor(m_threads, m_threads, [&](size_t begin, size_t end, unsigned){
+                for(size_t t = begin; t < end; ++t)
+                    for(auto& e : picked[t])
+                        dsu.unite(e.src, e.dest);
+            });
+            for(auto& p : picked){
+                m_result.insert(m_result.end(), p.begin(), p.end());
+                p.clear();
+            }
+            // Keep the roots that are still roots, and the edges that 
+            // connected two components at the start of the round. Edges that
+            // became internal in this round are dropped by the next one, 
+            // which saves two find() per edge. On a random graph most edges 
+            // keep crossing until the last rounds, so the edges are only 
+            // compacted once at least an eighth of them can go.
+            parallelFor(roots.size(), m_threads, [&](size_t begin, size_t end, unsigned t){
+                for(size_t i = begin; i < end; ++i)
+                    if(dsu.find(roots[i]) == roots[i] && best[roots[i]].load(memory_order_relaxed) != none)
+                        survivors[t].push_back(roots[i]);
+            });
+            roots.clear();
+            for(auto& r : survivors){
+                roots.insert(roots.end(), r.begin(), r.end());
+                r.clear();
+            }
+            if(accumulate(internal.begin(), internal.end(), size_t(0)) >= live.size() / 8){
+                vector<WeightedEdge> next;
+                size_t useful = parallelStablePartition(live, next, 
+                    [&](const WeightedEdge& e){ return crossing[&e - live.data()] != 0; },
+                    m_threads);
+                next.resize(useful);
+                live.swap(next);
+            }
+        }
+    }
+public:
+    explicit MstEngine(unsigned threads = 0): m_vertices(0), 
+        m_threads(threads ? threads : max(1u, thread::hardware_concurrency())){}
+
+    // Minimum spanning forest of the graph, edges by value so callers can 
+    // move theirs in. The result is in the order the edges were picked.
+    vector<WeightedEdge> run(size_t V, vector<WeightedEdge> edges, MstMode mode){
+        m_vertices = V;
+        m_dsu.reset(V);
+        m_result.clear();
+        m_result.reserve(V > 0 ? V - 1 : 0);
+        switch(mode){
+        case MstMode::Kruskal:
+            radixSortByWeight(edges, m_threads);
+            kruskalSorted(edges);
+            break;
+        case MstMode::FilterKruskal:
+            filterKruskal(edges);
+            break;
+        case MstMode::Boruvka:
+            // The packed (weight, position) key has 32 bits for the position
+            if(edges.size() > UINT32_MAX)
+                filterKruskal(edges);
+            else
+                boruvka(edges);
+            break;
+        }
+        return std::move(m_result);
+    }
+};
+
+// Driver program: the graph of section 17, then a large random graph
+int main()
+{
+    vector<WeightedEdge> small = {{0, 1, 10}, {0, 2, 6}, {0, 3, 5}, {1, 3, 15}, {2, 3, 4}};
+    MstEngine engine;
+    cout << "Following are the edges in the constructed MST\n";
+    for(auto& e : engine.run(4, small, MstMode::Kruskal))
+        cout << e.src << " -- " << e.dest << " == " << e.weight << endl;
+
+    const uint32_t V = 1000000;
+    const size_t E = 8000000;
+    mt19937_64 rng(3);
+    vector<WeightedEdge> edges(E);
+    for(auto& e : edges)
+        e = WeightedEdge{uint32_t(rng() % V), uint32_t(rng() % V), int32_t(rng() % 100000)};
+
+    const char* names[] = {"Kruskal", "FilterKruskal", "Boruvka"};
+    vector<vector<WeightedEdge>> results;
+    for(int m = 0; m < 3; ++m){
+        auto start = chrono::steady_clock::now();
+        results.push_back(engine.run(V, edges, MstMode(m)));
+        chrono::duration<double> sec = chrono::steady_clock::now() - start;
+        long long total = 0;
+        for(auto& e : results.back())
+            total += e.weight;
+        cout << names[m] << ": " << sec.count() << "s, " << results.back().size() 
+             << " edges, weight " << total << endl;
+    }
+    return 0;
+}
+
+
+
+//*********************************************************************
+//39. Compressed sparse row (CSR) graph shared by the graph algorithms
+/*
+The graph code above uses a different representation for every algorithm,
+all of them sized at compile time:
+    Dijkstra (12)       vector<pair<int,int>> v[SIZE], #define SIZE 100000 + 1
+    Bellman-Ford (13)   vector<vector<int>> v[2000 + 10], every edge is a 
+                        vector of 3 ints (3 heap blocks per edge)
+    isCycle/Kruskal     struct Graph with an edge array (11, 17)
+    Prim (19)           int graph[V][V] with #define V 5
+so none of them can run on the same graph, and the big ones waste memory 
+even for tiny inputs.
+
+CSR stores a graph in three flat arrays:
+    offsets[V+1]  edges of v are the positions [offsets[v], offsets[v+1])
+    targets[E]    32-bit head vertex of every edge
+    weights[E]    32-bit weight of every edge, next to nothing else
+Scanning the neighbors of v is a walk over two contiguous ranges, there is 
+no per-vertex heap block, and the size is whatever the input needs. offsets 
+are 64-bit so the graph can have more than 4G edges.
+
+Parallel construction from an edge list (counting sort by source):
+1. Every thread counts the out-degree of its chunk of edges with relaxed 
+atomic increments (an undirected edge counts for both endpoints).
+2. Exclusive prefix sum of the degrees gives offsets[] (chunk sums in 
+parallel, then a short sequential pass over the chunk totals).
+3. Every thread scatters its edges, each one claims a slot in its source's 
+range with an atomic fetch_add on a per-vertex cursor.
+4. The slot order in step 3 depends on thread timing, so every adjacency 
+range is sorted by (target, weight) at the end. The result is identical 
+for any number of threads.
+
+The builder takes a pointer and a count, so an edge array that is already in
+memory (or mmap()ed from disk) goes in without a copy. Because that array 
+may come from a file, step 1 also checks every endpoint against V: a bad 
+edge throws before anything is written through it.
+
+Below the struct are the algorithms of sections 11, 12, 13, 17 and 19 on top
+of it. Distances are int64_t and unreachable vertices are kInfDistance.
+*/
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+const int64_t kInfDistance = numeric_limits<int64_t>::max();
+
+class CsrGraph{
+private:
+    uint32_t m_vertices;
+    vector<uint64_t> m_offsets;
+    vector<uint32_t> m_targets;
+    vector<int32_t> m_weights;
+public:
+    CsrGraph(): m_vertices(0), m_offsets(1, 0){}
+
+    // Builds the graph from edges[0..m). An undirected graph stores every 
+    // edge in both directions. Throws out_of_range if V does not fit in 
+    // 32 bits or an edge has an endpoint >= V (e.g. a corrupt input file).
+    static CsrGraph fromEdges(size_t V, const WeightedEdge* edges, size_t m,
+                              bool undirected, unsigned threads = 0)
+    {
+        if(V > UINT32_MAX)
+            throw out_of_range("CsrGraph: more than 2^32 - 1 vertices");
+        CsrGraph g;
+        g.m_vertices = static_cast<uint32_t>(V);
+        unsigned chunks = threads ? threads : max(1u, thread::hardware_concurrency());
+        vector<atomic<uint64_t>> cursor(V);
+        parallelFor(V, chunks, [&](size_t begin, size_t end, unsigned){
+            for(size_t v = begin; v < end; ++v)
+                cursor[v].store(0, memory_order_relaxed);
+        });
+        // 1. degrees, and every endpoint is checked once here
+        vector<char> badChunk(chunks, 0);
+        parallelFor(m, chunks, [&](size_t begin, size_t end, unsigned t){
+            for(size_t i = begin; i < end; ++i){
+                if(edges[i].src >= V || edges[i].dest >= V){
+                    badChunk[t] = 1;
+                    return;
+                }
+                cursor[edges[i].src].fetch_add(1, memory_order_relaxed);
+                if(undirected)
+                    cursor[edges[i].dest].fetch_add(1, memory_order_relaxed);
+            }
+        });
+        if(find(badChunk.begin(), badChunk.end(), 1) != badChunk.end())
+            throw out_of_range("CsrGraph: edge endpoint >= vertex count");
+        // 2. exclusive prefix sum: chunk totals in parallel, then offsets
+        vector<uint64_t> chunkSum(chunks + 1, 0);
+        g.m_offsets.assign(V + 1, 0);
+        parallelFor(V, chunks, [&](size_t begin, size_t end, unsigned t){
+            uint64_t sum = 0;
+            for(size_t v = begin; v < end; ++v)
+                sum += cursor[v].load(memory_order_relaxed);
+            chunkSum[t + 1] = sum;
+        });
+        partial_sum(chunkSum.begin(), chunkSum.end(), chunkSum.begin());
+        parallelFor(V, chunks, [&](size_t begin, size_t end, unsigned t){
+            uint64_t sum = chunkSum[t];
+            for(size_t v = begin; v < end; ++v){
+                g.m_offsets[v] = sum;
+                sum += cursor[v].load(memory_order_relaxed);
+                cursor[v].store(g.m_offsets[v], memory_order_relaxed);
+            }
+        });
+        g.m_offsets[V] = chunkSum[chunks];
+        // 3. scatter
+        g.m_targets.resize(g.m_offsets[V]);
+        g.m_weights.resize(g.m_offsets[V]);
+        parallelFor(m, threads, [&](size_t begin, size_t end, unsigned){
+            for(size_t i = begin; i < end; ++i){
+                const WeightedEdge& e = edges[i];
+                uint64_t pos = cursor[e.src].fetch_add(1, memory_order_relaxed);
+                g.m_targets[pos] = e.dest;
+                g.m_weights[pos] = e.weight;
+                if(undirected){
+                    pos = cursor[e.dest].fetch_add(1, memory_order_relaxed);
+                    g.m_targets[pos] = e.src;
+                    g.m_weights[pos] = e.weight;
+                }
+            }
+        });
+        // 4. canonical order inside every adjacency range
+        parallelFor(V, threads, [&](size_t begin, size_t end, unsigned){
+            vector<pair<uint32_t, int32_t>> adj;
+            for(size_t v = begin; v < end; ++v){
+                uint64_t first = g.m_offsets[v], last = g.m_offsets[v + 1];
+                adj.clear();
+                for(uint64_t e = first; e < last; ++e)
+                    adj.emplace_back(g.m_targets[e], g.m_weights[e]);
+                sort(adj.begin(), adj.end());
+                for(uint64_t e = first; e < last; ++e){
+                    g.m_targets[e] = adj[e - first].first;
+                    g.m_weights[e] = adj[e - first].second;
+                }
+            }
+        });
+        return g;
+    }
+
+    static CsrGraph fromEdges(size_t V, const vector<WeightedEdge>& edges, 
+                              bool undirected, unsigned threads = 0){
+        return fromEdges(V, edges.data(), edges.size(), undirected, threads);
+    }
+
+    // Same graph with every edge reversed (for searches towards a target)
+    CsrGraph reversed(unsigned threads = 0) const{
+        vector<WeightedEdge> edges;
+        edges.reserve(edgeCount());
+        for(uint32_t u = 0; u < m_vertices; ++u)
+            for(uint64_t e = edgesBegin(u); e < edgesEnd(u); ++e)
+                edges.push_back(WeightedEdge{m_targets[e], u, m_weights[e]});
+        return fromEdges(m_vertices, edges, false, threads);
+    }
+
+    uint32_t vertexCount() const { return m_vertices; }
+    uint64_t edgeCount() const { return m_targets.size(); }
+    uint64_t edgesBegin(uint32_t v) const { return m_offsets[v]; }
+    uint64_t edgesEnd(uint32_t v) const { return m_offsets[v + 1]; }
+    uint32_t degree(uint32_t v) const { return uint32_t(m_offsets[v + 1] - m_offsets[v]); }
+    uint32_t target(uint64_t e) const { return m_targets[e]; }
+    int32_t weight(uint64_t e) const { return m_weights[e]; }
+
+    // Bytes used by the three arrays
+    size_t memoryUsage() const{
+        return m_offsets.size() * sizeof(uint64_t) + m_targets.size() * sizeof(uint32_t)
+             + m_weights.size() * sizeof(int32_t);
+    }
+};
+
+// Section 12 on CSR: any source, weights must be non-negative
+vector<int64_t> dijkstra(const CsrGraph& g, uint32_t source)
+{
+    vector<int64_t> dist(g.vertexCount(), kInfDistance);
+    // min-priority queue of (distance, vertex), stale entries are skipped
+    priority_queue<pair<int64_t, uint32_t>, vector<pair<int64_t, uint32_t>>,
+                   greater<pair<int64_t, uint32_t>>> pq;
+    dist[source] = 0;
+    pq.push({0, source});
+    while(!pq.empty()){
+        auto top = pq.top();
+        pq.pop();
+        uint32_t u = top.second;
+        if(top.first != dist[u])
+            continue;
+        for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e){
+            uint32_t v = g.target(e);
+            int64_t nd = top.first + g.weight(e);
+            if(nd < dist[v]){
+                dist[v] = nd;
+                pq.push({nd, v});
+            }
+        }
+    }
+    return dist;
+}
+
+// Section 13 on CSR. Stops as soon as a round changes nothing, and runs the
+// extra round of the notes: returns false if a negative cycle is reachable.
+bool bellmanFord(const CsrGraph& g, uint32_t source, vector<int64_t>& dist)
+{
+    uint32_t n = g.vertexCount();
+    dist.assign(n, kInfDistance);
+    dist[source] = 0;
+    for(uint32_t round = 0; round < n; ++round){
+        bool changed = false;
+        for(uint32_t u = 0; u < n; ++u){
+            if(dist[u] == kInfDistance)
+                continue;
+            for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e){
+                int64_t nd = dist[u] + g.weight(e);
+                if(nd < dist[g.target(e)]){
+                    dist[g.target(e)] = nd;
+                    changed = true;
+                }
+            }
+        }
+        if(!changed)
+            return true;
+    }
+    // Still improving in round n: a negative cycle
+    return false;
+}
+
+// Section 19 on CSR with a heap, O(ElogV). The graph must be undirected. 
+// Returns parent[], -1 for the root of every tree of the forest.
+vector<int32_t> primMST(const CsrGraph& g)
+{
+    uint32_t n = g.vertexCount();
+    vector<int32_t> parent(n, -1);
+    vector<int64_t> key(n, kInfDistance);
+    vector<bool> inMST(n, false);
+    priority_queue<pair<int64_t, uint32_t>, vector<pair<int64_t, uint32_t>>,
+                   greater<pair<int64_t, uint32_t>>> pq;
+    for(uint32_t root = 0; root < n; ++root){
+        if(inMST[root])
+            continue;
+        key[root] = 0;
+        pq.push({0, root});
+        while(!pq.empty()){
+            uint32_t u = pq.top().second;
+            pq.pop();
+            if(inMST[u])
+                continue;
+            inMST[u] = true;
+            for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e){
+                uint32_t v = g.target(e);
+                if(!inMST[v] && g.weight(e) < key[v]){
+                    key[v] = g.weight(e);
+                    parent[v] = static_cast<int32_t>(u);
+                    pq.push({key[v], v});
+                }
+            }
+        }
+    }
+    return parent;
+}
+
+// Section 17 on CSR (undirected), using the MST engine of section 38
+vector<WeightedEdge> kruskalMST(const CsrGraph& g)
+{
+    vector<WeightedEdge> edges;
+    for(uint32_t u = 0; u < g.vertexCount(); ++u)
+        for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e)
+            if(u < g.target(e))
+                edges.push_back(WeightedEdge{u, g.target(e), g.weight(e)});
+    return MstEngine().run(g.vertexCount(), std::move(edges), MstMode::Kruskal);
+}
+
+// Section 11 on CSR: cycle in an undirected graph. Both directions of an 
+// edge are stored, so only u < v is looked at; a self loop is a cycle.
+bool hasCycle(const CsrGraph& g)
+{
+    DisjointSet<> dsu(g.vertexCount());
+    for(uint32_t u = 0; u < g.vertexCount(); ++u)
+        for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e){
+            uint32_t v = g.target(e);
+            if(u == v || (u < v && !dsu.unite(u, v)))
+                return true;
+        }
+    return false;
+}
+
+// Cycle in a directed graph: Kahn's topological sort gets stuck on a cycle
+bool hasDirectedCycle(const CsrGraph& g)
+{
+    uint32_t n = g.vertexCount();
+    vector<uint32_t> indegree(n, 0), ready;
+    for(uint64_t e = 0; e < g.edgeCount(); ++e)
+        ++indegree[g.target(e)];
+    for(uint32_t v = 0; v < n; ++v)
+        if(indegree[v] == 0)
+            ready.push_back(v);
+    uint32_t removed = 0;
+    while(!ready.empty()){
+        uint32_t u = ready.back();
+        ready.pop_back();
+        ++removed;
+        for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e)
+            if(--indegree[g.target(e)] == 0)
+                ready.push_back(g.target(e));
+    }
+    return removed != n;
+}
+
+// Driver program: the graph of section 19 through every algorithm
+int main()
+{
+    vector<WeightedEdge> edges = {{0, 1, 2}, {0, 3, 6}, {1, 2, 3}, {1, 3, 8}, 
+                                  {1, 4, 5}, {2, 4, 7}, {3, 4, 9}};
+    CsrGraph g = CsrGraph::fromEdges(5, edges, true);
+
+    vector<int64_t> dist = dijkstra(g, 0), bf;
+    bool noNegativeCycle = bellmanFord(g, 0, bf);
+    cout << "Vertex  Dijkstra  Bellman-Ford" << endl;
+    for(uint32_t v = 0; v < g.vertexCount(); ++v)
+        cout << v << "       " << dist[v] << "         " << bf[v] << endl;
+    cout << "negative cycle: " << !noNegativeCycle << endl;
+
+    vector<int32_t> parent = primMST(g);
+    cout << "Edge \tWeight (Prim)" << endl;
+    for(uint32_t v = 1; v < g.vertexCount(); ++v)
+        for(uint64_t e = g.edgesBegin(v); e < g.edgesEnd(v); ++e)
+            if(int32_t(g.target(e)) == parent[v]){
+                cout << parent[v] << " - " << v << " \t" << g.weight(e) << endl;
+                break;
+            }
+    long long total = 0;
+    for(auto& e : kruskalMST(g))
+        total += e.weight;
+    cout << "Kruskal total weight " << total << ", cycle: " << hasCycle(g)
+         << ", directed cycle in a DAG: " 
+         << hasDirectedCycle(CsrGraph::fromEdges(5, edges, false)) << endl;
+
+    edges.push_back(WeightedEdge{2, 5, 1});
+    try{
+        CsrGraph::fromEdges(5, edges, true);
+    }catch(const out_of_range& e){
+        cout << "rejected: " << e.what() << endl;
+    }
+    return 0;
+}
+
+
+
+//*********************************************************************
+//40. Reusable Dijkstra workspace for many point-to-point queries
+/*
+dijkstra() in section 12 clears dist[] and vis[] for all 100001 vertices 
+before every query, always starts at vertex 1 and always settles the whole 
+graph. For many short point-to-point queries the clearing alone costs more 
+than the search. (It also did memset(dist, INT_MAX, ...), which sets every 
+byte to 0xff, so "infinity" was -1; section 12 uses fill() now.)
+
+DijkstraWorkspace keeps its arrays between queries and never clears them:
+1. Next to dist[] and parent[] there is a stamp[] array and a generation 
+counter. A vertex's dist/parent are only valid if stamp[v] == generation, 
+anything else reads as "infinity, not reached".
+2. Starting a query is ++generation: O(1), every entry becomes stale at once.
+Only after 2^32 queries does the counter wrap, and then we clear stamp[] once.
+3. The query stops as soon as the target is popped from the heap (its 
+distance is final at that point), so a nearby target only touches its 
+neighbourhood, and the cost of a query is proportional to what it explores,
+not to V.
+4. path(target) follows parent[] back to the source.
+5. The heap's vector is reused as well, so a warm query does not allocate.
+
+One workspace per thread: forThisThread() returns a thread_local instance, 
+so a server thread pool can answer queries on a shared const CsrGraph with 
+no locking and no allocation.
+
+Optional potentials (used by section 48): with a potential p[] such that 
+w(u,v) + p[u] - p[v] >= 0 for every edge, the search runs on those reduced 
+weights and distance() converts back to the real distance.
+*/
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+using namespace std;
+
+class DijkstraWorkspace{
+private:
+    vector<int64_t> m_dist;
+    vector<uint32_t> m_parent;
+    vector<uint32_t> m_stamp;
+    uint32_t m_generation;
+    vector<pair<int64_t, uint32_t>> m_heap;
+    uint32_t m_source;
+    const int64_t* m_potential;
+    uint64_t m_settled;
+
+    bool reached(uint32_t v) const { return m_stamp[v] == m_generation; }
+
+    void prepare(uint32_t n){
+        if(m_stamp.size() != n){
+            m_dist.assign(n, 0);
+            m_parent.assign(n, 0);
+            m_stamp.assign(n, 0);
+            m_generation = 0;
+        }
+        if(++m_generation == 0){
+            // Wrapped around after 2^32 queries: clear once
+            fill(m_stamp.begin(), m_stamp.end(), 0);
+            m_generation = 1;
+        }
+        m_heap.clear();
+        m_settled = 0;
+    }
+public:
+    static const uint32_t kNoTarget = UINT32_MAX;
+    static const uint32_t kNoParent = UINT32_MAX;
+
+    DijkstraWorkspace(): m_generation(0), m_source(0), m_potential(nullptr), m_settled(0){}
+
+    static DijkstraWorkspace& forThisThread(){
+        static thread_local DijkstraWorkspace workspace;
+        return workspace;
+    }
+
+    // Shortest paths from source. With a target it stops once the target
+    // is settled and returns its distance (kInfDistance if unreachable);
+    // without a target it settles everything reachable and returns 0.
+    int64_t run(const CsrGraph& g, uint32_t source, uint32_t target = kNoTarget,
+                const int64_t* potential = nullptr)
+    {
+        prepare(g.vertexCount());
+        m_source = source;
+        m_potential = potential;
+        auto later = greater<pair<int64_t, uint32_t>>();
+
+        m_stamp[source] = m_generation;
+        m_dist[source] = 0;
+        m_parent[source] = kNoParent;
+        m_heap.push_back({0, source});
+        while(!m_heap.empty()){
+            pop_heap(m_heap.begin(), m_heap.end(), later);
+            auto top = m_heap.back();
+            m_heap.pop_back();
+            uint32_t u = top.second;
+            // Stale entry, u was reached again with a shorter distance
+            if(top.first != m_dist[u])
+                continue;
+            ++m_settled;
+            if(u == target)
+                return distance(target);
+            for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e){
+                uint32_t v = g.target(e);
+                int64_t w = g.weight(e);
+                if(potential)
+                    w += potential[u] - potential[v];
+                int64_t nd = top.first + w;
+                if(!reached(v) || nd < m_dist[v]){
+                    m_stamp[v] = m_generation;
+                    m_dist[v] = nd;
+                    m_parent[v] = u;
+                    m_heap.push_back({nd, v});
+                    push_heap(m_heap.begin(), m_heap.end(), later);
+                }
+            }
+        }
+        return target == kNoTarget ? 0 : kInfDistance;
+    }
+
+    // Distance of the last query, kInfDistance if v was not reached. Only 
+    // final for settled vertices if the query stopped at a target.
+    int64_t distance(uint32_t v) const{
+        if(!reached(v))
+            return kInfDistance;
+        if(m_potential)
+            return m_dist[v] - m_potential[m_source] + m_potential[v];
+        return m_dist[v];
+    }
+
+    // Vertices from the source to target, empty if it was not reached
+    vector<uint32_t> path(uint32_t target) const{
+        vector<uint32_t> result;
+        if(!reached(target))
+            return result;
+        for(uint32_t v = target; v != kNoParent; v = m_parent[v])
+            result.push_back(v);
+        reverse(result.begin(), result.end());
+        return result;
+    }
+
+    // Number of vertices settled by the last query
+    uint64_t settledCount() const { return m_settled; }
+};
+
+// Driver program: many short queries on a 316 x 316 grid
+int main()
+{
+    const uint32_t side = 316, V = side * side;
+    mt19937 rng(1);
+    vector<WeightedEdge> edges;
+    for(uint32_t r = 0; r < side; ++r)
+        for(uint32_t c = 0; c < side; ++c){
+            uint32_t v = r * side + c;
+            if(c + 1 < side) edges.push_back(WeightedEdge{v, v + 1, int32_t(1 + rng() % 10)});
+            if(r + 1 < side) edges.push_back(WeightedEdge{v, v + side, int32_t(1 + rng() % 10)});
+        }
+    CsrGraph g = CsrGraph::fromEdges(V, edges, true);
+
+    DijkstraWorkspace& ws = DijkstraWorkspace::forThisThread();
+    int64_t d = ws.run(g, 0, 2 * side + 2);
+    cout << "0 -> " << 2 * side + 2 << ": distance " << d << ", path";
+    for(uint32_t v : ws.path(2 * side + 2))
+        cout << " " << v;
+    cout << endl;
+
+    // Nearby pairs, the common case for our traffic
+    const int queries = 20000;
+    vector<pair<uint32_t, uint32_t>> pairs;
+    for(int i = 0; i < queries; ++i){
+        uint32_t s = rng() % V;
+        uint32_t t = min(V - 1, s + uint32_t(rng() % 5) * side + uint32_t(rng() % 5));
+        pairs.push_back({s, t});
+    }
+    auto start = chrono::steady_clock::now();
+    int64_t checksum = 0;
+    for(auto& p : pairs)
+        checksum += ws.run(g, p.first, p.second);
+    chrono::duration<double, micro> us = chrono::steady_clock::now() - start;
+    cout << "workspace: " << us.count() / queries << " us per query" << endl;
+
+    start = chrono::steady_clock::now();
+    int64_t check = 0;
+    for(int i = 0; i < 200; ++i)
+        check += dijkstra(g, pairs[i].first)[pairs[i].second];
+    us = chrono::steady_clock::now() - start;
+    int64_t expected = 0;
+    for(int i = 0; i < 200; ++i)
+        expected += ws.run(g, pairs[i].first, pairs[i].second);
+    cout << "full dijkstra() of section 39: " << us.count() / 200 << " us per query, "
+         << (check == expected ? "same" : "DIFFERENT") << " distances" << endl;
+    return checksum < 0;
+}
+
+
+
+//*********************************************************************
+//41. Delta-stepping: parallel single source shortest paths
+/*
+Dijkstra settles one vertex at a time, in order of distance, so there is 
+nothing to hand to a second core. Delta-stepping relaxes that order: tentative
+distances are grouped into buckets of width delta ([0, delta), [delta, 
+2 delta), ...) and all vertices of the lowest non empty bucket are processed 
+together, in parallel.
+
+1. An edge is light if its weight is <= delta and heavy otherwise. Relaxing a
+light edge out of bucket i can put the target back into bucket i, so light 
+edges are relaxed in rounds until bucket i stays empty. A heavy edge always 
+lands in a later bucket, so heavy edges are relaxed once, after bucket i is 
+done and the distances of its vertices are final. (The CSR arrays are shared
+and read only, so the classification is a compare against delta per edge 
+rather than a reordering of the adjacency lists.)
+2. Every thread pushes into its own bucket array, so no locks are needed 
+when a relaxation moves a vertex. A vertex can sit in several buckets; the 
+copies whose bucket no longer matches dist[v] / delta are skipped.
+3. dist[] is an array of atomics and an improvement is an atomic min 
+(compare_exchange loop). Whichever thread wins pushes the vertex.
+4. Pending distances are always in [i * delta, i * delta + delta + maxWeight),
+so maxWeight / delta + 2 buckets used cyclically are enough.
+5. Small rounds run on the calling thread only: parallelFor() starts threads 
+per call, which is not worth it for a frontier of a few hundred vertices.
+
+delta = 0 picks it automatically: maxWeight / average degree, the usual 
+choice for random graphs (about one light edge per vertex ends up in the same
+bucket). A small delta approaches Dijkstra (little parallelism, little wasted
+work), a large one approaches Bellman-Ford (lots of parallelism, vertices 
+relaxed many times).
+
+With non negative weights the result is exactly the distances dijkstra() of 
+section 39 computes, which the driver checks.
+*/
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+using namespace std;
+
+int64_t maxEdgeWeight(const CsrGraph& g, unsigned threads = 0)
+{
+    unsigned chunks = threads ? threads : max(1u, thread::hardware_concurrency());
+    vector<int64_t> chunkMax(chunks, 0);
+    parallelFor(g.edgeCount(), chunks, [&](size_t begin, size_t end, unsigned t){
+        int64_t best = 0;
+        for(size_t e = begin; e < end; ++e)
+            best = max<int64_t>(best, g.weight(e));
+        chunkMax[t] = best;
+    });
+    return *max_element(chunkMax.begin(), chunkMax.end());
+}
+
+// Bucket width for deltaStepping(): max weight / average degree
+int64_t chooseDelta(const CsrGraph& g, unsigned threads = 0)
+{
+    int64_t maxWeight = maxEdgeWeight(g, threads);
+    int64_t degree = g.vertexCount() ? int64_t(g.edgeCount() / g.vertexCount()) : 0;
+    return max<int64_t>(1, maxWeight / max<int64_t>(1, degree));
+}
+
+// Distances from source, kInfDistance for unreachable vertices. Weights 
+// must be non negative. delta == 0 means chooseDelta().
+vector<int64_t> deltaStepping(const CsrGraph& g, uint32_t source, unsigned threads = 0,
+                              int64_t delta = 0)
+{
+    const size_t kParallelGrain = 1024;
+    if(threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+    if(delta <= 0)
+        delta = chooseDelta(g, threads);
+    int64_t maxWeight = maxEdgeWeight(g, threads);
+    // Not more than 65536 buckets per thread, however small delta is
+    delta = max<int64_t>(delta, maxWeight >> 16);
+    const uint64_t bucketCount = uint64_t(maxWeight / delta) + 2;
+
+    size_t V = g.vertexCount();
+    vector<atomic<int64_t>> dist(V);
+    vector<atomic<bool>> settled(V);
+    parallelFor(V, threads, [&](size_t begin, size_t end, unsigned){
+        for(size_t v = begin; v < end; ++v){
+            dist[v].store(kInfDistance, memory_order_relaxed);
+            settled[v].store(false, memory_order_relaxed);
+        }
+    });
+
+    struct alignas(64) Local{
+        vector<vector<uint32_t>> buckets;
+        vector<uint32_t> settled;          // vertices of the current bucket
+        uint64_t pushed = 0;
+    };
+    vector<Local> local(threads);
+    for(auto& l : local)
+        l.buckets.resize(bucketCount);
+
+    auto relax = [&](uint32_t v, int64_t nd, unsigned t){
+        int64_t old = dist[v].load(memory_order_relaxed);
+        while(nd < old){
+            if(dist[v].compare_exchange_weak(old, nd, memory_order_relaxed)){
+                local[t].buckets[uint64_t(nd / delta) % bucketCount].push_back(v);
+                ++local[t].pushed;
+                return;
+            }
+        }
+    };
+
+    relax(source, 0, 0);
+    uint64_t drained = 0;
+    vector<uint32_t> frontier;
+    for(uint64_t current = 0; ; ++current){
+        uint64_t pushed = 0;
+        for(auto& l : local)
+            pushed += l.pushed;
+        if(pushed == drained)
+            break;
+        uint64_t slot = current % bucketCount;
+        for(auto& l : local)
+            l.settled.clear();
+
+        // Light edges, until nothing falls back into this bucket
+        while(true){
+            frontier.clear();
+            for(auto& l : local){
+                drained += l.buckets[slot].size();
+                for(uint32_t v : l.buckets[slot])
+                    if(uint64_t(dist[v].load(memory_order_relaxed) / delta) == current)
+                        frontier.push_back(v);
+                l.buckets[slot].clear();
+            }
+            if(frontier.empty())
+                break;
+            unsigned active = frontier.size() < kParallelGrain ? 1 : threads;
+            parallelFor(frontier.size(), active, [&](size_t begin, size_t end, unsigned t){
+                for(size_t i = begin; i < end; ++i){
+                    uint32_t u = frontier[i];
+                    int64_t d = dist[u].load(memory_order_relaxed);
+                    if(!settled[u].exchange(true, memory_order_relaxed))
+                        local[t].settled.push_back(u);
+                    for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e)
+                        if(g.weight(e) <= delta)
+                            relax(g.target(e), d + g.weight(e), t);
+                }
+            });
+        }
+
+        // Heavy edges, once, from the now final distances of this bucket
+        frontier.clear();
+        for(auto& l : local)
+            frontier.insert(frontier.end(), l.settled.begin(), l.settled.end());
+        unsigned active = frontier.size() < kParallelGrain ? 1 : threads;
+        parallelFor(frontier.size(), active, [&](size_t begin, size_t end, unsigned t){
+            for(size_t i = begin; i < end; ++i){
+                uint32_t u = frontier[i];
+                int64_t d = dist[u].load(memory_order_relaxed);
+                for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e)
+                    if(g.weight(e) > delta)
+                        relax(g.target(e), d + g.weight(e), t);
+            }
+        });
+    }
+
+    vector<int64_t> result(V);
+    for(size_t v = 0; v < V; ++v)
+        result[v] = dist[v].load(memory_order_relaxed);
+    return result;
+}
+
+// Driver program: random sparse graph and a grid, checked against dijkstra()
+int main()
+{
+    mt19937 rng(7);
+    const uint32_t V = 200000;
+    vector<WeightedEdge> edges;
+    for(uint32_t i = 0; i < 8 * V; ++i)
+        edges.push_back(WeightedEdge{uint32_t(rng() % V), uint32_t(rng() % V), int32_t(rng() % 1000)});
+    CsrGraph g = CsrGraph::fromEdges(V, edges, false);
+    cout << "random graph, delta " << chooseDelta(g) << endl;
+
+    auto start = chrono::steady_clock::now();
+    vector<int64_t> expected = dijkstra(g, 0);
+    chrono::duration<double, milli> ms = chrono::steady_clock::now() - start;
+    cout << "  dijkstra(): " << ms.count() << " ms" << endl;
+    for(unsigned threads : {1u, 4u, 0u}){
+        start = chrono::steady_clock::now();
+        vector<int64_t> dist = deltaStepping(g, 0, threads);
+        ms = chrono::steady_clock::now() - start;
+        cout << "  deltaStepping() with " << threads << " threads: " << ms.count() << " ms, "
+             << (dist == expected ? "same" : "DIFFERENT") << " distances" << endl;
+    }
+
+    // A grid has a long diameter: many buckets with small frontiers
+    const uint32_t side = 300;
+    edges.clear();
+    for(uint32_t r = 0; r < side; ++r)
+        for(uint32_t c = 0; c < side; ++c){
+            uint32_t v = r * side + c;
+            if(c + 1 < side) edges.push_back(WeightedEdge{v, v + 1, int32_t(rng() % 10)});
+            if(r + 1 < side) edges.push_back(WeightedEdge{v, v + side, int32_t(rng() % 10)});
+        }
+    CsrGraph grid = CsrGraph::fromEdges(side * side, edges, true);
+    expected = dijkstra(grid, 0);
+    for(int64_t delta : {0, 1, 50})
+        cout << "grid, delta " << delta << ": "
+             << (deltaStepping(grid, 0, 4, delta) == expected ? "same" : "DIFFERENT")
+             << " distances" << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//42. Bidirectional A* with landmarks (ALT) for point-to-point queries
+/*
+DijkstraWorkspace of section 40 stops at the target, but it still grows a 
+ball around the source until the ball reaches the target, in every direction.
+Two ideas shrink the search:
+
+1. Bidirectional: search forward from s and backward from t (on the reversed
+graph) at the same time. Two balls of radius d/2 are much smaller than one 
+ball of radius d. Every time an edge reaches a vertex the other side has 
+already reached, mu = best s-t distance seen so far is updated. The search 
+stops once topForward + topBackward >= mu.
+
+2. A* with landmarks (ALT): pick a few landmark vertices L and store 
+d(L, v) and d(v, L) for every v (one Dijkstra per landmark and direction, 
+done once). The triangle inequality then gives lower bounds, for example
+    d(v, t) >= d(L, t) - d(L, v)      d(v, t) >= d(v, L) - d(t, L)
+and h_t(v) = the largest of these over all landmarks. Ordering the heap by 
+dist + h_t instead of dist steers the search towards t.
+
+Combined, forward and backward use the potential p(v) = (h_t(v) - h_s(v)) / 2
+(-p for the backward side), which keeps both reduced graphs non negative so 
+the stop rule above still holds. We keep 2 p(v) so everything stays in 
+integers. A vertex that provably cannot reach t, or be reached from s, is 
+skipped altogether.
+
+Landmarks are chosen "farthest": each new landmark is the vertex farthest 
+from the ones already picked, so they end up on the edge of the graph, where 
+the bounds are tight. The table is written once with write() and loaded by 
+every server with read(). It has 2 x 8 bytes per vertex per landmark, so 
+8 to 16 landmarks is the usual budget.
+
+AltRouter with an empty AltLandmarks is plain bidirectional Dijkstra. The 
+driver compares the settled vertex counts of the three.
+*/
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <random>
+#include <iostream>
+using namespace std;
+
+class AltLandmarks{
+private:
+    uint32_t m_vertices;
+    vector<uint32_t> m_landmarks;
+    vector<int64_t> m_from;    // m_from[v * k + i] = d(landmark i, v)
+    vector<int64_t> m_to;      // m_to[v * k + i] = d(v, landmark i)
+public:
+    AltLandmarks(): m_vertices(0){}
+
+    // count landmarks chosen farthest first, starting from seed's farthest
+    static AltLandmarks build(const CsrGraph& g, size_t count, uint32_t seed = 0){
+        AltLandmarks table;
+        uint32_t V = static_cast<uint32_t>(g.vertexCount());
+        table.m_vertices = V;
+        if(V == 0 || count == 0)
+            return table;
+        CsrGraph back = g.reversed();
+        vector<vector<int64_t>> from, to;
+        vector<int64_t> nearest(V, kInfDistance);   // to the closest landmark
+        vector<int64_t> dist = dijkstra(g, seed);
+        uint32_t next = seed;
+        for(uint32_t v = 0; v < V; ++v)
+            if(dist[v] != kInfDistance && dist[v] > dist[next])
+                next = v;
+        while(table.m_landmarks.size() < count){
+            table.m_landmarks.push_back(next);
+            from.push_back(dijkstra(g, next));
+            to.push_back(dijkstra(back, next));
+            int64_t best = -1;
+            for(uint32_t v = 0; v < V; ++v){
+                nearest[v] = min(nearest[v], from.back()[v]);
+                if(nearest[v] != kInfDistance && nearest[v] > best){
+                    best = nearest[v];
+                    next = v;
+                }
+            }
+            if(best <= 0)
+                break;      // every reachable vertex is a landmark already
+        }
+        size_t k = table.m_landmarks.size();
+        table.m_from.resize(size_t(V) * k);
+        table.m_to.resize(size_t(V) * k);
+        for(uint32_t v = 0; v < V; ++v)
+            for(size_t i = 0; i < k; ++i){
+                table.m_from[v * k + i] = from[i][v];
+                table.m_to[v * k + i] = to[i][v];
+            }
+        return table;
+    }
+
+    // Lower bound on d(v, t); kInfDistance if v provably cannot reach t
+    int64_t toTarget(uint32_t v, uint32_t t) const{
+        size_t k = m_landmarks.size();
+        const int64_t *fv = &m_from[v * k], *ft = &m_from[t * k];
+        const int64_t *tv = &m_to[v * k], *tt = &m_to[t * k];
+        int64_t bound = 0;
+        for(size_t i = 0; i < k; ++i){
+            if(ft[i] != kInfDistance && fv[i] != kInfDistance)
+                bound = max(bound, ft[i] - fv[i]);
+            if(tt[i] != kInfDistance){
+                if(tv[i] == kInfDistance)
+                    return kInfDistance;     // t reaches L but v does not
+                bound = max(bound, tv[i] - tt[i]);
+            }
+        }
+        return bound;
+    }
+
+    // Lower bound on d(s, v); kInfDistance if s provably cannot reach v
+    int64_t fromSource(uint32_t s, uint32_t v) const{
+        size_t k = m_landmarks.size();
+        const int64_t *fv = &m_from[v * k], *fs = &m_from[s * k];
+        const int64_t *tv = &m_to[v * k], *ts = &m_to[s * k];
+        int64_t bound = 0;
+        for(size_t i = 0; i < k; ++i){
+            if(fs[i] != kInfDistance){
+                if(fv[i] == kInfDistance)
+                    return kInfDistance;     // L reaches s but not v
+                bound = max(bound, fv[i] - fs[i]);
+            }
+            if(ts[i] != kInfDistance && tv[i] != kInfDistance)
+                bound = max(bound, ts[i] - tv[i]);
+        }
+        return bound;
+    }
+
+    const vector<uint32_t>& landmarks() const { return m_landmarks; }
+    uint32_t vertexCount() const { return m_vertices; }
+
+    void write(ostream& out) const{
+        uint64_t header[2] = {m_vertices, m_landmarks.size()};
+        out.write("ALTLMRK1", 8);
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(m_landmarks.data()), m_landmarks.size() * sizeof(uint32_t));
+        out.write(reinterpret_cast<const char*>(m_from.data()), m_from.size() * sizeof(int64_t));
+        out.write(reinterpret_cast<const char*>(m_to.data()), m_to.size() * sizeof(int64_t));
+    }
+
+    // Returns false (and leaves the table unchanged) on a bad stream. At 
+    // most one landmark per vertex, so V * k cannot overflow, and the 
+    // tables are read with readArray() (section 34).
+    bool read(istream& in){
+        char magic[8];
+        uint64_t header[2];
+        if(!in.read(magic, 8) || memcmp(magic, "ALTLMRK1", 8) != 0
+           || !in.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] > UINT32_MAX
+           || header[1] > header[0])
+            return false;
+        AltLandmarks loaded;
+        loaded.m_vertices = static_cast<uint32_t>(header[0]);
+        if(!readArray(in, loaded.m_landmarks, header[1])
+           || !readArray(in, loaded.m_from, header[0] * header[1])
+           || !readArray(in, loaded.m_to, header[0] * header[1]))
+            return false;
+        for(uint32_t landmark : loaded.m_landmarks)
+            if(landmark >= loaded.m_vertices)
+                return false;
+        *this = move(loaded);
+        return true;
+    }
+};
+
+// Point-to-point queries on one graph. Not thread safe, use one per thread.
+class AltRouter{
+private:
+    typedef pair<int64_t, uint32_t> Entry;     // (2 dist +- 2 p, vertex)
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Side{
+        const CsrGraph* graph;
+        vector<int64_t> dist;
+        vector<uint32_t> parent;
+        vector<uint32_t> stamp;
+        vector<Entry> heap;
+    };
+
+    const CsrGraph& m_graph;
+    CsrGraph m_reversed;
+    const AltLandmarks& m_landmarks;
+    Side m_side[2];                    // 0 forward from s, 1 backward from t
+    vector<int64_t> m_potential;       // 2 p(v), kInfDistance if v is useless
+    vector<uint32_t> m_potentialStamp;
+    uint32_t m_generation;
+    uint32_t m_source, m_target, m_meet;
+    uint64_t m_settled;
+
+    bool reached(int side, uint32_t v) const { return m_side[side].stamp[v] == m_generation; }
+
+    int64_t potential(uint32_t v){
+        if(m_potentialStamp[v] != m_generation){
+            m_potentialStamp[v] = m_generation;
+            int64_t ht = 0, hs = 0;
+            if(!m_landmarks.landmarks().empty()){
+                ht = m_landmarks.toTarget(v, m_target);
+                hs = m_landmarks.fromSource(m_source, v);
+            }
+            m_potential[v] = (ht == kInfDistance || hs == kInfDistance) ? kInfDistance : ht - hs;
+        }
+        return m_potential[v];
+    }
+
+    int64_t key(int side, uint32_t v, int64_t d){
+        return side == 0 ? 2 * d + potential(v) : 2 * d - potential(v);
+    }
+
+    void push(int side, uint32_t v, int64_t d, uint32_t parent){
+        Side& s = m_side[side];
+        s.stamp[v] = m_generation;
+        s.dist[v] = d;
+        s.parent[v] = parent;
+        s.heap.push_back({key(side, v, d), v});
+        push_heap(s.heap.begin(), s.heap.end(), greater<Entry>());
+    }
+public:
+    // Throws invalid_argument if the landmark table (e.g. one read() from a
+    // file) was built for a graph with a different number of vertices
+    AltRouter(const CsrGraph& g, const AltLandmarks& landmarks)
+        : m_graph(g), m_reversed(g.reversed()), m_landmarks(landmarks),
+          m_generation(0), m_source(0), m_target(0), m_meet(kNone), m_settled(0)
+    {
+        size_t V = g.vertexCount();
+        if(!landmarks.landmarks().empty() && landmarks.vertexCount() != V)
+            throw invalid_argument("AltRouter: landmark table is for another graph");
+        m_side[0].graph = &m_graph;
+        m_side[1].graph = &m_reversed;
+        for(Side& s : m_side){
+            s.dist.assign(V, 0);
+            s.parent.assign(V, kNone);
+            s.stamp.assign(V, 0);
+        }
+        m_potential.assign(V, 0);
+        m_potentialStamp.assign(V, 0);
+    }
+
+    // Distance from s to t, kInfDistance if t is not reachable. Throws 
+    // out_of_range if s or t is not a vertex of the graph.
+    int64_t query(uint32_t s, uint32_t t){
+        if(s >= m_graph.vertexCount() || t >= m_graph.vertexCount())
+            throw out_of_range("AltRouter: vertex out of range");
+        if(++m_generation == 0){
+            for(Side& side : m_side)
+                fill(side.stamp.begin(), side.stamp.end(), 0);
+            fill(m_potentialStamp.begin(), m_potentialStamp.end(), 0);
+            m_generation = 1;
+        }
+        m_source = s;
+        m_target = t;
+        m_meet = kNone;
+        m_settled = 0;
+        m_side[0].heap.clear();
+        m_side[1].heap.clear();
+        // The landmarks may already prove that s cannot reach t; then the
+        // backward key of t would be about -INT64_MAX and both searches would
+        // run until a heap is empty
+        if(potential(s) == kInfDistance || potential(t) == kInfDistance)
+            return kInfDistance;
+        push(0, s, 0, kNone);
+        push(1, t, 0, kNone);
+        int64_t mu = kInfDistance;
+        if(s == t){
+            m_meet = s;
+            return 0;
+        }
+
+        while(!m_side[0].heap.empty() && !m_side[1].heap.empty()){
+            int64_t top0 = m_side[0].heap.front().first, top1 = m_side[1].heap.front().first;
+            if(mu != kInfDistance && top0 + top1 >= 2 * mu)
+                break;
+            int side = top0 <= top1 ? 0 : 1;
+            Side& cur = m_side[side];
+            pop_heap(cur.heap.begin(), cur.heap.end(), greater<Entry>());
+            Entry top = cur.heap.back();
+            cur.heap.pop_back();
+            uint32_t u = top.second;
+            int64_t du = cur.dist[u];
+            if(top.first != key(side, u, du))
+                continue;       // stale, u was reached again with a shorter distance
+            ++m_settled;
+            const CsrGraph& g = *cur.graph;
+            for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e){
+                uint32_t v = g.target(e);
+                int64_t nd = du + g.weight(e);
+                if(potential(v) == kInfDistance)
+                    continue;
+                if(!reached(side, v) || nd < cur.dist[v])
+                    push(side, v, nd, u);
+                if(reached(1 - side, v) && nd + m_side[1 - side].dist[v] < mu){
+                    mu = nd + m_side[1 - side].dist[v];
+                    m_meet = v;
+                }
+            }
+        }
+        return mu;
+    }
+
+    // Vertices of the last query's shortest path, empty if there is none
+    vector<uint32_t> path() const{
+        vector<uint32_t> result;
+        if(m_meet == kNone)
+            return result;
+        for(uint32_t v = m_meet; v != kNone; v = m_side[0].parent[v])
+            result.push_back(v);
+        reverse(result.begin(), result.end());
+        for(uint32_t v = m_side[1].parent[m_meet]; v != kNone; v = m_side[1].parent[v])
+            result.push_back(v);
+        return result;
+    }
+
+    // Vertices settled (both directions) by the last query
+    uint64_t settledCount() const { return m_settled; }
+};
+
+// Driver program: a road like grid, queries between random far apart points
+int main()
+{
+    const uint32_t side = 400, V = side * side;
+    mt19937 rng(3);
+    vector<WeightedEdge> edges;
+    for(uint32_t r = 0; r < side; ++r)
+        for(uint32_t c = 0; c < side; ++c){
+            uint32_t v = r * side + c;
+            if(c + 1 < side) edges.push_back(WeightedEdge{v, v + 1, int32_t(10 + rng() % 20)});
+            if(r + 1 < side) edges.push_back(WeightedEdge{v, v + side, int32_t(10 + rng() % 20)});
+        }
+    CsrGraph g = CsrGraph::fromEdges(V, edges, true);
+
+    AltLandmarks none;
+    AltLandmarks built = AltLandmarks::build(g, 8);
+    stringstream file;
+    built.write(file);
+    AltLandmarks loaded;
+    cout << "landmark table: " << file.str().size() << " bytes, read back "
+         << (loaded.read(file) ? "ok" : "FAILED") << endl;
+
+    AltRouter bidirectional(g, none), alt(g, loaded);
+    DijkstraWorkspace& ws = DijkstraWorkspace::forThisThread();
+    const int queries = 200;
+    uint64_t settledFull = 0, settledTarget = 0, settledBi = 0, settledAlt = 0;
+    bool same = true;
+    for(int i = 0; i < queries; ++i){
+        uint32_t s = rng() % V, t = rng() % V;
+        int64_t expected = ws.run(g, s, t);
+        settledTarget += ws.settledCount();
+        settledFull += V;       // dijkstra() settles every vertex
+        same &= bidirectional.query(s, t) == expected;
+        settledBi += bidirectional.settledCount();
+        same &= alt.query(s, t) == expected;
+        settledAlt += alt.settledCount();
+        int64_t length = 0;
+        vector<uint32_t> p = alt.path();
+        for(size_t j = 0; j + 1 < p.size(); ++j)
+            for(uint64_t e = g.edgesBegin(p[j]); e < g.edgesEnd(p[j]); ++e)
+                if(g.target(e) == p[j + 1]){
+                    length += g.weight(e);
+                    break;
+                }
+        same &= p.front() == s && p.back() == t && length == expected;
+    }
+    cout << "distances and paths " << (same ? "match" : "DIFFER") << endl;
+    cout << "settled vertices per query:" << endl
+         << "  dijkstra()                 " << settledFull / queries << endl
+         << "  stop at target (sec. 40)   " << settledTarget / queries << endl
+         << "  bidirectional              " << settledBi / queries << endl
+         << "  bidirectional ALT          " << settledAlt / queries << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//43. Bellman-Ford engine: queue based (SPFA), parallel rounds, negative cycles
+/*
+Section 13 keeps every edge as a vector<int> of three ints (three heap 
+allocations per edge, a pointer chase per field) and always runs n-1 full 
+rounds. BellmanFordEngine keeps the edges as one flat array of WeightedEdge 
+(12 bytes each, read front to back) and has two modes:
+
+1. Queue (SPFA): only a vertex whose distance just dropped can improve its 
+neighbours, so keep those in a FIFO queue (each vertex at most once in it) 
+and relax only their out edges. It stops as soon as the queue is empty; on 
+most graphs that is after a few passes' worth of work instead of n-1 rounds.
+It needs the out edges per vertex, so this mode uses a CsrGraph built from 
+the flat array.
+
+2. ParallelRounds: classic rounds over the flat array, split across threads 
+with parallelFor(). A round reads the distances of the previous round and 
+writes the new ones with an atomic min, and edges whose source did not 
+change last round are skipped. It stops at the first round that changes 
+nothing.
+
+Negative cycles: every vertex remembers the vertex it was last improved 
+from (parent). A cycle in the parent pointers is always a negative cycle, and
+if a negative cycle is reachable from the source one eventually shows up, 
+because otherwise every distance would be the length of a simple path and 
+could not keep decreasing. So the engine looks for a cycle in the parent 
+pointers (O(V), they form a functional graph) every V relaxations in queue 
+mode and after every round in round mode, and returns it as soon as it finds 
+one. The check is cheap enough that a cycle is usually found long before 
+round n.
+
+Weights are int32_t and distances int64_t, so no sum can overflow.
+*/
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+using namespace std;
+
+enum class BellmanFordMode{ Queue, ParallelRounds };
+
+class BellmanFordEngine{
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    size_t m_vertices;
+    vector<WeightedEdge> m_edges;
+    CsrGraph m_graph;             // only built for the queue mode
+    unsigned m_threads;
+    vector<int64_t> m_dist;
+    vector<uint32_t> m_parent;
+    vector<uint32_t> m_cycle;
+    uint64_t m_relaxations;
+
+    // A cycle of the parent pointers in edge order, empty if there is none
+    vector<uint32_t> findParentCycle(const vector<uint32_t>& parent) const{
+        vector<uint32_t> walk(m_vertices, kNone);   // start of the walk that visited v
+        for(uint32_t start = 0; start < m_vertices; ++start){
+            uint32_t v = start;
+            while(v != kNone && walk[v] == kNone){
+                walk[v] = start;
+                v = parent[v];
+            }
+            if(v == kNone || walk[v] != start)
+                continue;
+            // v is on a cycle found by this walk
+            vector<uint32_t> cycle;
+            uint32_t u = v;
+            do{
+                cycle.push_back(u);
+                u = parent[u];
+            }while(u != v);
+            reverse(cycle.begin(), cycle.end());
+            return cycle;
+        }
+        return vector<uint32_t>();
+    }
+
+    bool runQueue(uint32_t source){
+        if(m_graph.vertexCount() != m_vertices)
+            m_graph = CsrGraph::fromEdges(m_vertices, m_edges, false, m_threads);
+        vector<char> queued(m_vertices, 0);
+        deque<uint32_t> queue(1, source);
+        queued[source] = 1;
+        uint64_t nextCheck = m_vertices;
+        while(!queue.empty()){
+            uint32_t u = queue.front();
+            queue.pop_front();
+            queued[u] = 0;
+            for(uint64_t e = m_graph.edgesBegin(u); e < m_graph.edgesEnd(u); ++e){
+                uint32_t v = m_graph.target(e);
+                int64_t nd = m_dist[u] + m_graph.weight(e);
+                if(nd >= m_dist[v])
+                    continue;
+                m_dist[v] = nd;
+                m_parent[v] = u;
+                if(!queued[v]){
+                    queued[v] = 1;
+                    queue.push_back(v);
+                }
+                if(++m_relaxations == nextCheck){
+                    nextCheck += m_vertices;
+                    m_cycle = findParentCycle(m_parent);
+                    if(!m_cycle.empty())
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool runRounds(uint32_t source){
+        size_t m = m_edges.size();
+        vector<atomic<int64_t>> next(m_vertices);
+        vector<atomic<uint32_t>> parent(m_vertices);
+        vector<char> changed(m_vertices, 0);
+        changed[source] = 1;
+        vector<uint64_t> relaxed(max(1u, m_threads ? m_threads : thread::hardware_concurrency()), 0);
+        unsigned chunks = static_cast<unsigned>(relaxed.size());
+        parallelFor(m_vertices, chunks, [&](size_t begin, size_t end, unsigned){
+            for(size_t v = begin; v < end; ++v){
+                next[v].store(m_dist[v], memory_order_relaxed);
+                parent[v].store(m_parent[v], memory_order_relaxed);
+            }
+        });
+
+        while(true){
+            // Pass 1: atomic min of all improvements, from last round's distances
+            parallelFor(m, chunks, [&](size_t begin, size_t end, unsigned t){
+                uint64_t count = 0;
+                for(size_t i = begin; i < end; ++i){
+                    const WeightedEdge& e = m_edges[i];
+                    if(!changed[e.src])
+                        continue;
+                    int64_t nd = m_dist[e.src] + e.weight;
+                    int64_t old = next[e.dest].load(memory_order_relaxed);
+                    while(nd < old && !next[e.dest].compare_exchange_weak(old, nd, memory_order_relaxed))
+                        ;
+                    count += nd < old;
+                }
+                relaxed[t] += count;
+            });
+            // Pass 2: an edge that produced the new minimum becomes the parent
+            parallelFor(m, chunks, [&](size_t begin, size_t end, unsigned){
+                for(size_t i = begin; i < end; ++i){
+                    const WeightedEdge& e = m_edges[i];
+                    int64_t nd = next[e.dest].load(memory_order_relaxed);
+                    if(changed[e.src] && nd < m_dist[e.dest] && m_dist[e.src] + e.weight == nd)
+                        parent[e.dest].store(e.src, memory_order_relaxed);
+                }
+            });
+            bool any = false;
+            for(size_t v = 0; v < m_vertices; ++v){
+                int64_t nd = next[v].load(memory_order_relaxed);
+                changed[v] = nd < m_dist[v];
+                any |= changed[v] != 0;
+                m_dist[v] = nd;
+                m_parent[v] = parent[v].load(memory_order_relaxed);
+            }
+            if(!any)
+                break;
+            m_cycle = findParentCycle(m_parent);
+            if(!m_cycle.empty())
+                break;
+        }
+        for(uint64_t count : relaxed)
+            m_relaxations += count;
+        return m_cycle.empty();
+    }
+public:
+    BellmanFordEngine(size_t V, vector<WeightedEdge> edges, unsigned threads = 0)
+        : m_vertices(V), m_edges(move(edges)), m_threads(threads), m_relaxations(0){}
+
+    // Shortest distances from source. Returns false if a negative cycle is 
+    // reachable from it; negativeCycle() then has one and distances() are 
+    // meaningless.
+    bool run(uint32_t source, BellmanFordMode mode = BellmanFordMode::Queue){
+        m_dist.assign(m_vertices, kInfDistance);
+        m_parent.assign(m_vertices, kNone);
+        m_cycle.clear();
+        m_relaxations = 0;
+        m_dist[source] = 0;
+        return mode == BellmanFordMode::Queue ? runQueue(source) : runRounds(source);
+    }
+
+    const vector<int64_t>& distances() const { return m_dist; }
+
+    // Vertices of the cycle in edge order: cycle[i] -> cycle[i + 1] -> ... -> cycle[0]
+    const vector<uint32_t>& negativeCycle() const { return m_cycle; }
+
+    // Number of distance improvements of the last run
+    uint64_t relaxations() const { return m_relaxations; }
+};
+
+// Driver program: random graph with negative edges but no negative cycle 
+// (weights w + p[u] - p[v] with w >= 0), then the same graph with one
+int main()
+{
+    mt19937 rng(5);
+    const uint32_t V = 100000;
+    vector<int32_t> p(V);
+    for(auto& x : p)
+        x = rng() % 1000;
+    vector<WeightedEdge> edges;
+    for(uint32_t i = 0; i < 8 * V; ++i){
+        uint32_t u = rng() % V, v = rng() % V;
+        edges.push_back(WeightedEdge{u, v, int32_t(rng() % 100) + p[u] - p[v]});
+    }
+
+    BellmanFordEngine engine(V, edges);
+    vector<int64_t> expected;
+    auto start = chrono::steady_clock::now();
+    bellmanFord(CsrGraph::fromEdges(V, edges, false), 0, expected);
+    chrono::duration<double, milli> ms = chrono::steady_clock::now() - start;
+    cout << "bellmanFord() of section 39: " << ms.count() << " ms" << endl;
+    for(auto mode : {BellmanFordMode::Queue, BellmanFordMode::ParallelRounds}){
+        start = chrono::steady_clock::now();
+        bool ok = engine.run(0, mode);
+        ms = chrono::steady_clock::now() - start;
+        cout << (mode == BellmanFordMode::Queue ? "queue:  " : "rounds: ") << ms.count() << " ms, "
+             << engine.relaxations() << " relaxations, "
+             << (ok && engine.distances() == expected ? "same" : "DIFFERENT") << " distances" << endl;
+    }
+
+    // Close a negative cycle 10 -> 20 -> 30 -> 10
+    edges.push_back(WeightedEdge{10, 20, -5});
+    edges.push_back(WeightedEdge{20, 30, -5});
+    edges.push_back(WeightedEdge{30, 10, -5});
+    edges.push_back(WeightedEdge{0, 10, 0});
+    BellmanFordEngine cyclic(V, edges);
+    for(auto mode : {BellmanFordMode::Queue, BellmanFordMode::ParallelRounds}){
+        bool ok = cyclic.run(0, mode);
+        cout << (mode == BellmanFordMode::Queue ? "queue:  " : "rounds: ")
+             << (ok ? "no negative cycle" : "negative cycle") << ":";
+        for(uint32_t v : cyclic.negativeCycle())
+            cout << " " << v;
+        cout << endl;
+    }
+    return 0;
+}
+
+
+
+//*********************************************************************
+//44. Blocked, vectorized and parallel Floyd–Warshall
+/*
+The triple loop of section 14 streams the whole V x V matrix through the 
+cache once per k: at V = 8192 that is 256 MB read and written 8192 times, 
+and the loop is bound by memory bandwidth, not by the additions.
+
+Blocked Floyd–Warshall cuts the matrix into B x B tiles (B = 64, a 16 KB 
+tile of int32_t) and runs the k loop one block of B values at a time. For 
+block round kb:
+1. Phase 1: the diagonal tile (kb, kb) runs plain Floyd–Warshall on itself.
+2. Phase 2: the tiles of row kb and column kb are updated from the diagonal 
+tile. They are independent of each other, so they run in parallel.
+3. Phase 3: every other tile (i, j) does C = min(C, A + B) with A = tile 
+(i, kb) and B = tile (kb, j), both final for this round. This is almost 
+all of the work, all tiles are independent and run in parallel, and the 
+three tiles sit in L1/L2 while B^3 min-plus operations run on them.
+
+The inner loop over j is a min-plus on 8 int32_t at a time with AVX2 (a 
+scalar loop without it): broadcast d[i][k], add row k, compare, blend.
+
+Path reconstruction: next[i][j] is the first hop on the way from i to j. 
+It starts as j for every edge and becomes next[i][k] only when going 
+through k is strictly shorter: the same mask that selects the new distance 
+selects the new hop. (Section 14 copied path[k][j] even without an 
+improvement, which breaks the paths.) path(i, j) then follows next[][] from 
+i; it is O(path length) and needs no recursion.
+
+Distances are int32_t with kInf = 2^30 - 1 as "no path", so keep all path 
+lengths below 2^30. d[i][k] = kInf rows are skipped and kInf entries of row 
+k never produce an improvement, so negative weights do not turn kInf into a
+fake distance. With a negative cycle (hasNegativeCycle(), some d[i][i] < 0) 
+the distances are meaningless.
+*/
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+using namespace std;
+
+class FloydWarshall{
+public:
+    static constexpr int32_t kInf = (1 << 30) - 1;
+    static constexpr uint32_t kNone = UINT32_MAX;
+private:
+    static constexpr size_t kTile = 64;
+
+    size_t m_vertices;
+    size_t m_stride;                   // padded to a multiple of kTile
+    vector<int32_t> m_dist;            // row major, m_stride x m_stride
+    vector<uint32_t> m_next;
+
+    // C = min(C, A + B) on one tile, k outer so C may be A or B (phases 1, 2)
+    void minPlus(size_t ci, size_t cj, size_t ai, size_t aj, size_t bi, size_t bj){
+        int32_t* dist = m_dist.data();
+        uint32_t* next = m_next.data();
+        for(size_t k = 0; k < kTile; ++k){
+            const int32_t* brow = dist + (bi + k) * m_stride + bj;
+            for(size_t i = 0; i < kTile; ++i){
+                int32_t dik = dist[(ai + i) * m_stride + aj + k];
+                if(dik == kInf)
+                    continue;
+                uint32_t nik = next[(ai + i) * m_stride + aj + k];
+                int32_t* crow = dist + (ci + i) * m_stride + cj;
+                uint32_t* nrow = next + (ci + i) * m_stride + cj;
+                size_t j = 0;
+#ifdef __AVX2__
+                __m256i vdik = _mm256_set1_epi32(dik), vnik = _mm256_set1_epi32(int32_t(nik));
+                __m256i vinf = _mm256_set1_epi32(kInf);
+                for(; j < kTile; j += 8){
+                    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(brow + j));
+                    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(crow + j));
+                    __m256i sum = _mm256_add_epi32(vdik, b);
+                    // improved = sum < c and b != kInf
+                    __m256i improved = _mm256_andnot_si256(_mm256_cmpeq_epi32(b, vinf),
+                                                           _mm256_cmpgt_epi32(c, sum));
+                    if(_mm256_testz_si256(improved, improved))
+                        continue;
+                    __m256i* nj = reinterpret_cast<__m256i*>(nrow + j);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(crow + j), _mm256_blendv_epi8(c, sum, improved));
+                    _mm256_storeu_si256(nj, _mm256_blendv_epi8(_mm256_loadu_si256(nj), vnik, improved));
+                }
+#endif
+                for(; j < kTile; ++j)
+                    if(brow[j] != kInf && dik + brow[j] < crow[j]){
+                        crow[j] = dik + brow[j];
+                        nrow[j] = nik;
+                    }
+            }
+        }
+    }
+
+    // Phase 3: C is neither A nor B, so each row of C can stay in registers
+    // (32 columns at a time) while k runs over the whole tile
+    void minPlusIndependent(size_t ci, size_t cj, size_t ai, size_t aj, size_t bi, size_t bj){
+        int32_t* dist = m_dist.data();
+        uint32_t* next = m_next.data();
+        for(size_t i = 0; i < kTile; ++i){
+            const int32_t* arow = dist + (ai + i) * m_stride + aj;
+            const uint32_t* anext = next + (ai + i) * m_stride + aj;
+            for(size_t j0 = 0; j0 < kTile; j0 += 32){
+                int32_t* crow = dist + (ci + i) * m_stride + cj + j0;
+                uint32_t* nrow = next + (ci + i) * m_stride + cj + j0;
+#ifdef __AVX2__
+                __m256i c[4], n[4];
+                for(int x = 0; x < 4; ++x){
+                    c[x] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(crow + 8 * x));
+                    n[x] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(nrow + 8 * x));
+                }
+                __m256i vinf = _mm256_set1_epi32(kInf);
+                for(size_t k = 0; k < kTile; ++k){
+                    if(arow[k] == kInf)
+                        continue;
+                    __m256i vdik = _mm256_set1_epi32(arow[k]), vnik = _mm256_set1_epi32(int32_t(anext[k]));
+                    const int32_t* brow = dist + (bi + k) * m_stride + bj + j0;
+                    if(arow[k] >= 0){
+                        // d[i][k] + kInf >= kInf >= c, so no kInf check needed
+                        for(int x = 0; x < 4; ++x){
+                            __m256i sum = _mm256_add_epi32(vdik, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(brow + 8 * x)));
+                            n[x] = _mm256_blendv_epi8(n[x], vnik, _mm256_cmpgt_epi32(c[x], sum));
+                            c[x] = _mm256_min_epi32(c[x], sum);
+                        }
+                        continue;
+                    }
+                    for(int x = 0; x < 4; ++x){
+                        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(brow + 8 * x));
+                        __m256i sum = _mm256_add_epi32(vdik, b);
+                        // improved = sum < c and b != kInf
+                        __m256i improved = _mm256_andnot_si256(_mm256_cmpeq_epi32(b, vinf),
+                                                               _mm256_cmpgt_epi32(c[x], sum));
+                        c[x] = _mm256_blendv_epi8(c[x], sum, improved);
+                        n[x] = _mm256_blendv_epi8(n[x], vnik, improved);
+                    }
+                }
+                for(int x = 0; x < 4; ++x){
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(crow + 8 * x), c[x]);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(nrow + 8 * x), n[x]);
+                }
+#else
+                for(size_t k = 0; k < kTile; ++k){
+                    if(arow[k] == kInf)
+                        continue;
+                    const int32_t* brow = dist + (bi + k) * m_stride + bj + j0;
+                    for(size_t j = 0; j < 32; ++j)
+                        if(brow[j] != kInf && arow[k] + brow[j] < crow[j]){
+                            crow[j] = arow[k] + brow[j];
+                            nrow[j] = anext[k];
+                        }
+                }
+#endif
+            }
+        }
+    }
+public:
+    // V vertices and no edges yet
+    explicit FloydWarshall(size_t V)
+        : m_vertices(V), m_stride((V + kTile - 1) / kTile * kTile),
+          m_dist(m_stride * m_stride, kInf), m_next(m_stride * m_stride, kNone)
+    {
+        for(size_t v = 0; v < m_stride; ++v){
+            m_dist[v * m_stride + v] = 0;
+            m_next[v * m_stride + v] = static_cast<uint32_t>(v);
+        }
+    }
+
+    // Keeps the lightest of parallel edges
+    void addEdge(uint32_t u, uint32_t v, int32_t weight){
+        size_t at = size_t(u) * m_stride + v;
+        if(weight < m_dist[at]){
+            m_dist[at] = weight;
+            m_next[at] = v;
+        }
+    }
+
+    void run(unsigned threads = 0){
+        size_t blocks = m_stride / kTile;
+        for(size_t kb = 0; kb < blocks; ++kb){
+            size_t k0 = kb * kTile;
+            minPlus(k0, k0, k0, k0, k0, k0);
+
+            // Row kb and column kb: tile t < blocks is (kb, t), else (t - blocks, kb)
+            parallelFor(2 * blocks, threads, [&](size_t begin, size_t end, unsigned){
+                for(size_t t = begin; t < end; ++t){
+                    size_t b = (t % blocks) * kTile;
+                    if(b == k0)
+                        continue;
+                    if(t < blocks)
+                        minPlus(k0, b, k0, k0, k0, b);
+                    else
+                        minPlus(b, k0, b, k0, k0, k0);
+                }
+            });
+
+            parallelFor(blocks * blocks, threads, [&](size_t begin, size_t end, unsigned){
+                for(size_t t = begin; t < end; ++t){
+                    size_t i0 = (t / blocks) * kTile, j0 = (t % blocks) * kTile;
+                    if(i0 != k0 && j0 != k0)
+                        minPlusIndependent(i0, j0, i0, k0, k0, j0);
+                }
+            });
+        }
+    }
+
+    // kInf if there is no path
+    int32_t distance(uint32_t i, uint32_t j) const { return m_dist[size_t(i) * m_stride + j]; }
+
+    // Vertices from i to j, empty if there is no path
+    vector<uint32_t> path(uint32_t i, uint32_t j) const{
+        vector<uint32_t> result;
+        if(m_next[size_t(i) * m_stride + j] == kNone)
+            return result;
+        result.push_back(i);
+        while(i != j && result.size() <= m_vertices){
+            i = m_next[size_t(i) * m_stride + j];
+            result.push_back(i);
+        }
+        if(i != j)
+            result.clear();      // only possible with a negative cycle
+        return result;
+    }
+
+    bool hasNegativeCycle() const{
+        for(size_t v = 0; v < m_vertices; ++v)
+            if(m_dist[v * m_stride + v] < 0)
+                return true;
+        return false;
+    }
+
+    size_t vertexCount() const { return m_vertices; }
+};
+
+// Driver program: random graph with some negative edges (no negative cycle),
+// checked against the loop of section 14
+int main()
+{
+    const uint32_t V = 1024;
+    mt19937 rng(9);
+    vector<int32_t> p(V);
+    for(auto& x : p)
+        x = rng() % 100;
+    FloydWarshall fw(V);
+    vector<vector<int32_t>> dist(V, vector<int32_t>(V, FloydWarshall::kInf));
+    for(uint32_t v = 0; v < V; ++v)
+        dist[v][v] = 0;
+    for(uint32_t e = 0; e < 8 * V; ++e){
+        uint32_t u = rng() % V, v = rng() % V;
+        int32_t w = int32_t(rng() % 1000) + p[u] - p[v];
+        fw.addEdge(u, v, w);
+        dist[u][v] = min(dist[u][v], u == v ? 0 : w);
+    }
+
+    auto start = chrono::steady_clock::now();
+    for(uint32_t k = 0; k < V; ++k)
+        for(uint32_t i = 0; i < V; ++i)
+            for(uint32_t j = 0; j < V; ++j)
+                if(dist[i][k] != FloydWarshall::kInf && dist[k][j] != FloydWarshall::kInf
+                   && dist[i][k] + dist[k][j] < dist[i][j])
+                    dist[i][j] = dist[i][k] + dist[k][j];
+    chrono::duration<double, milli> ms = chrono::steady_clock::now() - start;
+    cout << "section 14 loop: " << ms.count() << " ms" << endl;
+
+    start = chrono::steady_clock::now();
+    fw.run();
+    ms = chrono::steady_clock::now() - start;
+    cout << "blocked: " << ms.count() << " ms" << endl;
+
+    bool same = !fw.hasNegativeCycle();
+    for(uint32_t i = 0; i < V; ++i)
+        for(uint32_t j = 0; j < V; ++j)
+            same &= fw.distance(i, j) == dist[i][j];
+    cout << "distances " << (same ? "match" : "DIFFER") << endl;
+
+    vector<uint32_t> path = fw.path(0, V - 1);
+    cout << "path 0 -> " << V - 1 << " (" << fw.distance(0, V - 1) << "):";
+    for(uint32_t v : path)
+        cout << " " << v;
+    cout << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//45. Bit-parallel transitive closure (reachability matrix)
+/*
+"Can i reach j" for all pairs is Floyd–Warshall on booleans:
+    for k: for i: for j: reach[i][j] |= reach[i][k] && reach[k][j]
+With an int per cell (section 14) that is 32 bits to store one bit. Stored as 
+rows of 64-bit words, the j loop becomes "if bit k of row i is set, row i |= 
+row k", 64 cells per OR, and 50K vertices take 312 MB instead of 10 GB.
+
+Two steps make it fast enough for 50K+ vertices:
+1. Strongly connected components (Tarjan, iterative): all vertices of a 
+component reach exactly the same set, so the matrix is built on components 
+only. Most real graphs shrink a lot; a DAG does not shrink at all.
+2. Tarjan numbers the components sinks first, so an edge c -> d between 
+components always has d < c. Then at step k of the loop above, bit k of row i 
+is set only if there is an edge i -> k (any other path to k would have to go 
+through a vertex > k), and row k is already final. So every edge of the 
+component graph costs exactly one row OR, and only of words [0, k / 64], 
+because row k has no bit above k.
+
+The k loop runs 64 steps (one word of every row) at a time: first the 64 rows 
+of the block among themselves, then all later rows in parallel, each walking 
+the set bits of its word for this block. Rows never write to each other, so 
+there is nothing to synchronize within a block.
+
+reachable(i, i) is true (reflexive closure).
+*/
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+using namespace std;
+
+class TransitiveClosure{
+private:
+    uint32_t m_vertices;
+    uint32_t m_components;
+    size_t m_words;                    // per row
+    vector<uint32_t> m_component;      // vertex -> component, sinks first
+    vector<uint64_t> m_rows;           // m_components rows of m_words
+
+    uint64_t* row(uint32_t c) { return &m_rows[size_t(c) * m_words]; }
+
+    // Iterative Tarjan, numbers components in the order they complete
+    void findComponents(const CsrGraph& g){
+        const uint32_t kUnvisited = UINT32_MAX;
+        vector<uint32_t> index(m_vertices, kUnvisited), low(m_vertices);
+        vector<uint32_t> stack;
+        vector<char> onStack(m_vertices, 0);
+        vector<pair<uint32_t, uint64_t>> calls;     // (vertex, next edge)
+        m_component.assign(m_vertices, 0);
+        m_components = 0;
+        uint32_t counter = 0;
+        for(uint32_t root = 0; root < m_vertices; ++root){
+            if(index[root] != kUnvisited)
+                continue;
+            calls.push_back({root, g.edgesBegin(root)});
+            index[root] = low[root] = counter++;
+            stack.push_back(root);
+            onStack[root] = 1;
+            while(!calls.empty()){
+                uint32_t v = calls.back().first;
+                uint64_t& e = calls.back().second;
+                if(e < g.edgesEnd(v)){
+                    uint32_t w = g.target(e++);
+                    if(index[w] == kUnvisited){
+                        index[w] = low[w] = counter++;
+                        stack.push_back(w);
+                        onStack[w] = 1;
+                        calls.push_back({w, g.edgesBegin(w)});
+                    }
+                    else if(onStack[w])
+                        low[v] = min(low[v], index[w]);
+                    continue;
+                }
+                calls.pop_back();
+                if(!calls.empty())
+                    low[calls.back().first] = min(low[calls.back().first], low[v]);
+                if(low[v] == index[v]){
+                    uint32_t w;
+                    do{
+                        w = stack.back();
+                        stack.pop_back();
+                        onStack[w] = 0;
+                        m_component[w] = m_components;
+                    }while(w != v);
+                    ++m_components;
+                }
+            }
+        }
+    }
+public:
+    TransitiveClosure(): m_vertices(0), m_components(0), m_words(0){}
+
+    static TransitiveClosure build(const CsrGraph& g, unsigned threads = 0){
+        TransitiveClosure tc;
+        tc.m_vertices = static_cast<uint32_t>(g.vertexCount());
+        tc.findComponents(g);
+        uint32_t C = tc.m_components;
+        tc.m_words = (C + 63) / 64;
+        tc.m_rows.assign(size_t(C) * tc.m_words, 0);
+        for(uint32_t c = 0; c < C; ++c)
+            tc.row(c)[c / 64] |= 1ULL << (c % 64);
+        for(uint32_t u = 0; u < tc.m_vertices; ++u)
+            for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e){
+                uint32_t d = tc.m_component[g.target(e)];
+                tc.row(tc.m_component[u])[d / 64] |= 1ULL << (d % 64);
+            }
+
+        // row i |= row k for bit k of row i, k < i, words [0, k / 64]
+        auto absorb = [&tc](uint64_t* target, uint32_t k){
+            const uint64_t* source = tc.row(k);
+            for(size_t w = 0; w <= k / 64; ++w)
+                target[w] |= source[w];
+        };
+        for(size_t block = 0; block < tc.m_words; ++block){
+            uint32_t k0 = static_cast<uint32_t>(block * 64);
+            uint32_t k1 = min<uint32_t>(C, k0 + 64);
+            for(uint32_t i = k0; i < k1; ++i){
+                uint64_t* r = tc.row(i);
+                // Bits below i only: bit i itself is the diagonal
+                uint64_t bits = r[block] & ((1ULL << (i - k0)) - 1);
+                for(; bits; bits &= bits - 1)
+                    absorb(r, k0 + __builtin_ctzll(bits));
+            }
+            parallelFor(C - k1, threads, [&](size_t begin, size_t end, unsigned){
+                for(size_t i = k1 + begin; i < k1 + end; ++i){
+                    uint64_t* r = tc.row(static_cast<uint32_t>(i));
+                    for(uint64_t bits = r[block]; bits; bits &= bits - 1)
+                        absorb(r, k0 + __builtin_ctzll(bits));
+                }
+            });
+        }
+        return tc;
+    }
+
+    bool reachable(uint32_t from, uint32_t to) const{
+        uint32_t a = m_component[from], b = m_component[to];
+        return (m_rows[size_t(a) * m_words + b / 64] >> (b % 64)) & 1;
+    }
+
+    // Vertices reachable from v (v included)
+    size_t reachableCount(uint32_t v) const{
+        size_t count = 0;
+        for(uint32_t u = 0; u < m_vertices; ++u)
+            count += reachable(v, u);
+        return count;
+    }
+
+    uint32_t componentCount() const { return m_components; }
+    size_t memoryUsage() const { return m_rows.size() * sizeof(uint64_t) + m_component.size() * sizeof(uint32_t); }
+};
+
+// Driver program: 60K vertices, mostly a DAG (a dependency graph) with a 
+// few cycles, checked against BFS
+int main()
+{
+    const uint32_t V = 60000;
+    mt19937 rng(4);
+    vector<WeightedEdge> edges;
+    for(uint32_t v = 1; v < V; ++v)
+        for(int i = 0; i < 2; ++i){
+            uint32_t u = v - 1 - rng() % min<uint32_t>(v, 2000);
+            edges.push_back(WeightedEdge{v, u, 1});
+        }
+    // Some 2-cycles, each one becomes a single component
+    for(int i = 0; i < 200; ++i){
+        uint32_t u = rng() % (V - 1);
+        edges.push_back(WeightedEdge{u, u + 1, 1});
+        edges.push_back(WeightedEdge{u + 1, u, 1});
+    }
+    CsrGraph g = CsrGraph::fromEdges(V, edges, false);
+
+    auto start = chrono::steady_clock::now();
+    TransitiveClosure tc = TransitiveClosure::build(g);
+    chrono::duration<double, milli> ms = chrono::steady_clock::now() - start;
+    cout << V << " vertices, " << tc.componentCount() << " components, "
+         << tc.memoryUsage() / (1 << 20) << " MB, built in " << ms.count() << " ms" << endl;
+
+    bool same = true;
+    for(int q = 0; q < 20; ++q){
+        uint32_t s = rng() % V;
+        vector<char> seen(V, 0);
+        vector<uint32_t> queue(1, s);
+        seen[s] = 1;
+        for(size_t h = 0; h < queue.size(); ++h)
+            for(uint64_t e = g.edgesBegin(queue[h]); e < g.edgesEnd(queue[h]); ++e)
+                if(!seen[g.target(e)]){
+                    seen[g.target(e)] = 1;
+                    queue.push_back(g.target(e));
+                }
+        for(uint32_t t = 0; t < V; ++t)
+            same &= tc.reachable(s, t) == bool(seen[t]);
+    }
+    cout << "reachability " << (same ? "matches" : "DIFFERS from") << " BFS" << endl;
+    cout << "vertex " << V - 1 << " reaches " << tc.reachableCount(V - 1) << " vertices" << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//46. Prim engine: indexed heap for sparse graphs, SIMD scans for dense ones
+/*
+Section 19 fixes the graph size at compile time (#define V 5), finds the next
+vertex with an O(V) minKey() scan and prints the tree instead of returning 
+it. primMST() of section 39 fixes the size problem but keeps the lazy heap: 
+every key decrease pushes another entry, so the heap holds up to E entries.
+
+PrimEngine has two modes and returns parent[] (-1 for the root of every tree,
+so a disconnected graph gives its minimum spanning forest):
+
+1. SparseHeap: an indexed binary heap over the CSR adjacency lists. pos[v] 
+says where v sits in the heap, so a smaller key moves v up in place 
+(decreaseKey) instead of pushing a duplicate. The heap never holds more than 
+V entries: O(E log V) time, O(V) extra memory.
+
+2. DenseMatrix: for a (nearly) complete graph the adjacency lists are a V x V
+matrix anyway, and the O(V^2) algorithm of section 19 is optimal. Per step it
+does one pass over key[] and the new vertex's matrix row, both contiguous:
+update key/parent where the row is smaller, and at the same time track the 
+smallest key for the next step. With AVX2 that is 8 vertices per instruction 
+(compare, blend, min), with a running min/index vector reduced at the end. 
+Vertices already in the tree have key kInTree (INT32_MAX) so they never win,
+and the blend mask excludes them from updates.
+
+Which one is faster depends on what the graph arrives as. From an edge list,
+Auto picks DenseMatrix when E >= V^2 / 32 (a matrix at least 1/16 full) and 
+the matrix fits in kDenseMaxVertices^2 int32_t (1 GB): scattering the edges 
+into a matrix is cheaper than building (and sorting) a CSR, and V^2 / 8 
+vector steps beat E heap operations with cache misses. When a CsrGraph 
+already exists, Auto uses the heap: converting the CSR to a matrix costs 
+more than the dense scan saves (3000 point complete graph: heap 22 ms, CSR ->
+matrix -> dense 35 ms, dense on a ready matrix 8 ms).
+
+Weights must be below INT32_MAX - 1 (the two largest values mark "in the 
+tree" and "not reached yet").
+*/
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+using namespace std;
+
+// Binary min heap of vertices with a position index, for decreaseKey
+class IndexedMinHeap{
+private:
+    static constexpr uint32_t kAbsent = UINT32_MAX;
+    vector<pair<int32_t, uint32_t>> m_heap;     // (key, vertex)
+    vector<uint32_t> m_pos;
+
+    void place(size_t i, pair<int32_t, uint32_t> item){
+        m_heap[i] = item;
+        m_pos[item.second] = static_cast<uint32_t>(i);
+    }
+
+    void siftUp(size_t i){
+        auto item = m_heap[i];
+        while(i > 0 && item.first < m_heap[(i - 1) / 2].first){
+            place(i, m_heap[(i - 1) / 2]);
+            i = (i - 1) / 2;
+        }
+        place(i, item);
+    }
+
+    void siftDown(size_t i){
+        auto item = m_heap[i];
+        size_t n = m_heap.size();
+        while(2 * i + 1 < n){
+            size_t c = 2 * i + 1;
+            if(c + 1 < n && m_heap[c + 1].first < m_heap[c].first)
+                ++c;
+            if(m_heap[c].first >= item.first)
+                break;
+            place(i, m_heap[c]);
+            i = c;
+        }
+        place(i, item);
+    }
+public:
+    explicit IndexedMinHeap(size_t n): m_pos(n, kAbsent){ m_heap.reserve(n); }
+
+    bool empty() const { return m_heap.empty(); }
+    bool contains(uint32_t v) const { return m_pos[v] != kAbsent; }
+
+    // Inserts v, or lowers its key if it is already in the heap. False if 
+    // v was in the heap with a key <= key.
+    bool pushOrDecrease(uint32_t v, int32_t key){
+        if(!contains(v)){
+            m_heap.push_back({key, v});
+            m_pos[v] = static_cast<uint32_t>(m_heap.size() - 1);
+        }
+        else if(key < m_heap[m_pos[v]].first)
+            m_heap[m_pos[v]].first = key;
+        else
+            return false;
+        siftUp(m_pos[v]);
+        return true;
+    }
+
+    uint32_t pop(){
+        uint32_t top = m_heap[0].second;
+        m_pos[top] = kAbsent;
+        auto last = m_heap.back();
+        m_heap.pop_back();
+        if(!m_heap.empty()){
+            place(0, last);
+            siftDown(0);
+        }
+        return top;
+    }
+};
+
+enum class PrimMode{ Auto, SparseHeap, DenseMatrix };
+
+class PrimEngine{
+public:
+    static constexpr int32_t kNoEdge = INT32_MAX;
+    static constexpr size_t kDenseMaxVertices = 16384;
+private:
+    static constexpr int32_t kInTree = INT32_MAX;
+    static constexpr int32_t kUnreached = INT32_MAX - 1;
+
+    unsigned m_threads;
+    PrimMode m_lastMode;
+
+    vector<int32_t> sparse(const CsrGraph& g){
+        uint32_t n = g.vertexCount();
+        vector<int32_t> parent(n, -1);
+        vector<char> inTree(n, 0);
+        IndexedMinHeap heap(n);
+        for(uint32_t root = 0; root < n; ++root){
+            if(inTree[root])
+                continue;
+            heap.pushOrDecrease(root, 0);
+            while(!heap.empty()){
+                uint32_t u = heap.pop();
+                inTree[u] = 1;
+                for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e){
+                    uint32_t v = g.target(e);
+                    if(!inTree[v] && heap.pushOrDecrease(v, g.weight(e)))
+                        parent[v] = static_cast<int32_t>(u);
+                }
+            }
+        }
+        return parent;
+    }
+public:
+    explicit PrimEngine(unsigned threads = 0): m_threads(threads), m_lastMode(PrimMode::Auto){}
+
+    // Minimum spanning forest of an undirected graph given as an edge list.
+    // Throws out_of_range for an endpoint >= n, in both modes (the sparse 
+    // one gets that from CsrGraph::fromEdges).
+    vector<int32_t> run(size_t n, const vector<WeightedEdge>& edges, PrimMode mode = PrimMode::Auto){
+        if(mode == PrimMode::Auto)
+            mode = (n <= kDenseMaxVertices && edges.size() >= n * n / 32)
+                 ? PrimMode::DenseMatrix : PrimMode::SparseHeap;
+        if(mode == PrimMode::SparseHeap)
+            return run(CsrGraph::fromEdges(n, edges, true, m_threads), mode);
+        vector<int32_t> matrix(n * n, kNoEdge);
+        for(const WeightedEdge& e : edges){
+            if(e.src >= n || e.dest >= n)
+                throw out_of_range("PrimEngine: edge endpoint >= vertex count");
+            int32_t w = min(matrix[size_t(e.src) * n + e.dest], e.weight);
+            matrix[size_t(e.src) * n + e.dest] = matrix[size_t(e.dest) * n + e.src] = w;
+        }
+        return run(matrix, n);
+    }
+
+    // Minimum spanning forest of an undirected CSR graph
+    vector<int32_t> run(const CsrGraph& g, PrimMode mode = PrimMode::Auto){
+        size_t n = g.vertexCount();
+        if(mode != PrimMode::DenseMatrix){
+            m_lastMode = PrimMode::SparseHeap;
+            return sparse(g);
+        }
+        vector<int32_t> matrix(n * n, kNoEdge);
+        parallelFor(n, m_threads, [&](size_t begin, size_t end, unsigned){
+            for(size_t u = begin; u < end; ++u)
+                for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e){
+                    int32_t& cell = matrix[u * n + g.target(e)];
+                    cell = min(cell, g.weight(e));
+                }
+        });
+        return run(matrix, n);
+    }
+
+    // Dense mode on a row major n x n matrix of weights, kNoEdge for none.
+    // The matrix must be symmetric; the diagonal is ignored.
+    vector<int32_t> run(const vector<int32_t>& matrix, size_t n){
+        m_lastMode = PrimMode::DenseMatrix;
+        vector<int32_t> parent(n, -1);
+        // Padded to a multiple of 8 so the vector loop needs no tail
+        size_t padded = (n + 7) / 8 * 8;
+        vector<int32_t> key(padded, kInTree);
+        fill(key.begin(), key.begin() + n, kUnreached);
+        vector<int32_t> row(padded, kNoEdge);
+        vector<int32_t> par(padded, -1);
+        uint32_t u = 0;
+        for(size_t step = 0; step < n; ++step){
+            // u joins the tree (as a new root if it was never reached)
+            key[u] = kInTree;
+            copy(matrix.begin() + u * n, matrix.begin() + (u + 1) * n, row.begin());
+            int32_t bestKey = kInTree;
+            uint32_t best = 0;
+            size_t v = 0;
+#ifdef __AVX2__
+            __m256i vmax = _mm256_set1_epi32(kInTree), vu = _mm256_set1_epi32(int32_t(u));
+            __m256i bestv = vmax, besti = _mm256_setzero_si256();
+            __m256i idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), eight = _mm256_set1_epi32(8);
+            for(; v < padded; v += 8){
+                __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&key[v]));
+                __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&row[v]));
+                __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&par[v]));
+                __m256i better = _mm256_andnot_si256(_mm256_cmpeq_epi32(k, vmax), _mm256_cmpgt_epi32(k, w));
+                k = _mm256_blendv_epi8(k, w, better);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(&key[v]), k);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(&par[v]), _mm256_blendv_epi8(p, vu, better));
+                __m256i smaller = _mm256_cmpgt_epi32(bestv, k);
+                bestv = _mm256_min_epi32(bestv, k);
+                besti = _mm256_blendv_epi8(besti, idx, smaller);
+                idx = _mm256_add_epi32(idx, eight);
+            }
+            alignas(32) int32_t lanes[8], lanesIdx[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), bestv);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanesIdx), besti);
+            for(int l = 0; l < 8; ++l)
+                if(lanes[l] < bestKey || (lanes[l] == bestKey && uint32_t(lanesIdx[l]) < best)){
+                    bestKey = lanes[l];
+                    best = uint32_t(lanesIdx[l]);
+                }
+#endif
+            for(; v < padded; ++v){
+                if(key[v] != kInTree && row[v] < key[v]){
+                    key[v] = row[v];
+                    par[v] = int32_t(u);
+                }
+                if(key[v] < bestKey){
+                    bestKey = key[v];
+                    best = uint32_t(v);
+                }
+            }
+            if(bestKey == kInTree)
+                break;          // every vertex is in the tree
+            u = best;
+            parent[u] = bestKey == kUnreached ? -1 : par[u];
+        }
+        return parent;
+    }
+
+    // Mode the last run() used
+    PrimMode lastMode() const { return m_lastMode; }
+};
+
+// Total weight of the forest described by parent[]
+int64_t forestWeight(const CsrGraph& g, const vector<int32_t>& parent)
+{
+    int64_t total = 0;
+    for(uint32_t v = 0; v < parent.size(); ++v){
+        if(parent[v] < 0)
+            continue;
+        int32_t best = INT32_MAX;
+        for(uint64_t e = g.edgesBegin(v); e < g.edgesEnd(v); ++e)
+            if(g.target(e) == uint32_t(parent[v]))
+                best = min(best, g.weight(e));
+        total += best;
+    }
+    return total;
+}
+
+// Driver program: a complete graph of random points and a large sparse graph,
+// both as edge lists
+int main()
+{
+    mt19937 rng(12);
+    PrimEngine engine;
+
+    const uint32_t dense = 3000;
+    vector<pair<int, int>> points(dense);
+    for(auto& p : points)
+        p = {int(rng() % 10000), int(rng() % 10000)};
+    vector<WeightedEdge> complete;
+    for(uint32_t u = 0; u < dense; ++u)
+        for(uint32_t v = u + 1; v < dense; ++v)
+            complete.push_back(WeightedEdge{u, v, abs(points[u].first - points[v].first)
+                                                 + abs(points[u].second - points[v].second)});
+
+    const uint32_t sparseV = 1000000;
+    vector<WeightedEdge> sparse;
+    for(uint32_t i = 0; i < 4 * sparseV; ++i)
+        sparse.push_back(WeightedEdge{uint32_t(rng() % sparseV), uint32_t(rng() % sparseV), int32_t(rng() % 100000)});
+
+    for(auto input : {make_pair(dense, &complete), make_pair(sparseV, &sparse)}){
+        size_t V = input.first;
+        const vector<WeightedEdge>& edges = *input.second;
+        cout << V << " vertices, " << edges.size() << " edges" << endl;
+        auto start = chrono::steady_clock::now();
+        CsrGraph g = CsrGraph::fromEdges(V, edges, true);
+        int64_t expected = forestWeight(g, primMST(g));
+        chrono::duration<double, milli> ms = chrono::steady_clock::now() - start;
+        cout << "  CSR + primMST() of section 39: " << ms.count() << " ms" << endl;
+        for(PrimMode mode : {PrimMode::SparseHeap, PrimMode::DenseMatrix, PrimMode::Auto}){
+            if(mode == PrimMode::DenseMatrix && V > PrimEngine::kDenseMaxVertices)
+                continue;
+            start = chrono::steady_clock::now();
+            vector<int32_t> parent = engine.run(V, edges, mode);
+            ms = chrono::steady_clock::now() - start;
+            cout << "  " << (mode == PrimMode::Auto ? "auto -> " : "")
+                 << (engine.lastMode() == PrimMode::SparseHeap ? "heap: " : "dense: ") << ms.count() << " ms, "
+                 << (forestWeight(g, parent) == expected ? "same" : "DIFFERENT") << " total weight" << endl;
+        }
+    }
+    return 0;
+}
+
+
+
+//*********************************************************************
+//47. Contraction hierarchies
+/*
+ALT (section 42) still explores thousands of vertices per query. On a static
+road-like network we can afford much more preprocessing to make every query 
+cheap. A contraction hierarchy orders the vertices by "importance" and 
+contracts them one by one, least important first:
+
+1. Contracting v removes it from the graph. For every pair u -> v -> w of 
+remaining neighbours, if u -> v -> w is the only shortest u-w path, add a 
+shortcut u -> w with weight d(u, v) + d(v, w) so distances between the 
+remaining vertices do not change.
+2. Witness search: a small Dijkstra from u that skips v, bounded by the 
+largest candidate weight and by kWitnessSettleLimit settled vertices, and 
+done as soon as every w is settled. If it finds a path to w no longer than 
+u -> v -> w, the shortcut is not needed. Giving up early only adds a 
+superfluous shortcut, never a wrong distance.
+3. Order: priority = edge difference (shortcuts added - edges removed) + 
+number of already contracted neighbours (spreads contractions evenly over 
+the graph). A lazy min heap holds the priorities; after a contraction the 
+neighbours' priorities are recomputed and pushed again, stale entries are 
+skipped. Priorities only need to be roughly right, so they count shortcuts 
+with a cheaper witness search (kEstimateSettleLimit); that cut the 
+preprocessing of the driver's grid from 20 s to 5 s.
+
+Every edge then points "up" (to a later contracted vertex) or "down". A 
+shortest path always goes up, then down, so a query is a bidirectional 
+Dijkstra where the forward search from s only follows up edges and the 
+backward search from t only follows down edges backwards (also upwards in 
+the order). Both searches stay in the top of the hierarchy and settle a few 
+hundred vertices; a side stops once its smallest key is >= the best meeting
+distance.
+
+The hierarchy (just the two upward CSR graphs, the order is not needed any 
+more) is written with write() and loaded with read(), so a restart does not 
+pay for the preprocessing again. Queries return distances; paths would need
+the middle vertex of every shortcut as well.
+*/
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+using namespace std;
+
+class ContractionHierarchy{
+private:
+    static constexpr size_t kWitnessSettleLimit = 500;
+    static constexpr size_t kEstimateSettleLimit = 50;
+    typedef pair<int64_t, uint32_t> Entry;
+
+    struct Arc{
+        uint32_t to;
+        int64_t weight;
+    };
+
+    // Upward graphs in CSR form: side 0 = up edges from v, side 1 = down 
+    // edges into v, stored reversed (v -> u for u -> v)
+    uint32_t m_vertices;
+    vector<uint64_t> m_offsets[2];
+    vector<uint32_t> m_targets[2];
+    vector<int64_t> m_weights[2];
+    uint64_t m_shortcuts;
+
+    // Query state, reset by generation as in section 40
+    vector<int64_t> m_dist[2];
+    vector<uint32_t> m_stamp[2];
+    vector<Entry> m_heap[2];
+    uint32_t m_generation;
+    uint64_t m_settled;
+
+    // The graph while it is being contracted
+    class Builder{
+    public:
+        vector<vector<Arc>> out, in;
+        vector<uint32_t> contractedNeighbours;
+        vector<vector<Arc>> up, down;      // arcs to higher vertices, per vertex
+        uint64_t shortcuts = 0;
+
+        vector<int64_t> dist;
+        vector<uint32_t> stamp;
+        vector<Entry> heap;
+        uint32_t generation = 0;
+        vector<uint64_t> targetStamp;
+        uint64_t targetGeneration = 0;
+
+        explicit Builder(const CsrGraph& g): out(g.vertexCount()), in(g.vertexCount()),
+            contractedNeighbours(g.vertexCount(), 0), up(g.vertexCount()), down(g.vertexCount()),
+            dist(g.vertexCount(), 0), stamp(g.vertexCount(), 0), targetStamp(g.vertexCount(), 0)
+        {
+            for(uint32_t u = 0; u < g.vertexCount(); ++u)
+                for(uint64_t e = g.edgesBegin(u); e < g.edgesEnd(u); ++e)
+                    if(g.target(e) != u)
+                        addArc(u, g.target(e), g.weight(e));
+        }
+
+        // Adds u -> w, or lowers the weight of an existing one
+        void addArc(uint32_t u, uint32_t w, int64_t weight){
+            for(Arc& a : out[u])
+                if(a.to == w){
+                    if(weight < a.weight){
+                        a.weight = weight;
+                        for(Arc& b : in[w])
+                            if(b.to == u)
+                                b.weight = weight;
+                    }
+                    return;
+                }
+            out[u].push_back(Arc{w, weight});
+            in[w].push_back(Arc{u, weight});
+        }
+
+        // Bounded Dijkstra from source in the remaining graph without skip.
+        // Stops early once all targets (marked with targetStamp) are settled.
+        void witnessSearch(uint32_t source, uint32_t skip, int64_t bound, size_t targets, size_t limit){
+            if(++generation == 0){
+                fill(stamp.begin(), stamp.end(), 0);
+                generation = 1;
+            }
+            heap.clear();
+            stamp[source] = generation;
+            dist[source] = 0;
+            heap.push_back({0, source});
+            size_t settled = 0;
+            while(!heap.empty() && settled < limit && targets > 0){
+                pop_heap(heap.begin(), heap.end(), greater<Entry>());
+                Entry top = heap.back();
+                heap.pop_back();
+                if(top.first != dist[top.second])
+                    continue;
+                if(top.first > bound)
+                    break;
+                ++settled;
+                if(targetStamp[top.second] == targetGeneration)
+                    --targets;
+                for(const Arc& a : out[top.second]){
+                    if(a.to == skip)
+                        continue;
+                    int64_t nd = top.first + a.weight;
+                    if(stamp[a.to] != generation || nd < dist[a.to]){
+                        stamp[a.to] = generation;
+                        dist[a.to] = nd;
+                        heap.push_back({nd, a.to});
+                        push_heap(heap.begin(), heap.end(), greater<Entry>());
+                    }
+                }
+            }
+        }
+
+        // Shortcuts (u, w, weight) that contracting v needs. A smaller 
+        // limit gives an estimate (more shortcuts) for the priorities.
+        vector<pair<pair<uint32_t, uint32_t>, int64_t>> shortcutsFor(uint32_t v, size_t limit){
+            vector<pair<pair<uint32_t, uint32_t>, int64_t>> result;
+            int64_t maxOut = 0;
+            ++targetGeneration;
+            for(const Arc& a : out[v]){
+                maxOut = max(maxOut, a.weight);
+                targetStamp[a.to] = targetGeneration;
+            }
+            for(const Arc& from : in[v]){
+                witnessSearch(from.to, v, from.weight + maxOut, out[v].size(), limit);
+                for(const Arc& to : out[v]){
+                    if(to.to == from.to)
+                        continue;
+                    int64_t via = from.weight + to.weight;
+                    if(stamp[to.to] != generation || dist[to.to] > via)
+                        result.push_back({{from.to, to.to}, via});
+                }
+            }
+            return result;
+        }
+
+        int64_t priority(uint32_t v){
+            int64_t added = static_cast<int64_t>(shortcutsFor(v, kEstimateSettleLimit).size());
+            int64_t removed = static_cast<int64_t>(in[v].size() + out[v].size());
+            return added - removed + contractedNeighbours[v];
+        }
+
+        // Removes v, records its arcs as upward and adds the shortcuts.
+        // Returns the neighbours whose priority changed.
+        vector<uint32_t> contract(uint32_t v){
+            auto needed = shortcutsFor(v, kWitnessSettleLimit);
+            up[v] = out[v];
+            down[v] = in[v];
+            vector<uint32_t> neighbours;
+            for(const Arc& a : out[v]){
+                auto& list = in[a.to];
+                list.erase(remove_if(list.begin(), list.end(), [v](const Arc& b){ return b.to == v; }), list.end());
+                neighbours.push_back(a.to);
+            }
+            for(const Arc& a : in[v]){
+                auto& list = out[a.to];
+                list.erase(remove_if(list.begin(), list.end(), [v](const Arc& b){ return b.to == v; }), list.end());
+                neighbours.push_back(a.to);
+            }
+            vector<Arc>().swap(out[v]);
+            vector<Arc>().swap(in[v]);
+            for(auto& s : needed)
+                addArc(s.first.first, s.first.second, s.second);
+            shortcuts += needed.size();
+            sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            for(uint32_t n : neighbours)
+                ++contractedNeighbours[n];
+            return neighbours;
+        }
+    };
+
+    void prepareQueries(){
+        for(int side = 0; side < 2; ++side){
+            m_dist[side].assign(m_vertices, 0);
+            m_stamp[side].assign(m_vertices, 0);
+        }
+        m_generation = 0;
+    }
+public:
+    ContractionHierarchy(): m_vertices(0), m_shortcuts(0), m_generation(0), m_settled(0){
+        for(int side = 0; side < 2; ++side)
+            m_offsets[side].assign(1, 0);
+    }
+
+    // Throws invalid_argument for a negative edge weight: the witness 
+    // searches are Dijkstra and would drop needed shortcuts (read() rejects
+    // negative weights for the same reason).
+    static ContractionHierarchy build(const CsrGraph& g){
+        for(uint64_t e = 0; e < g.edgeCount(); ++e)
+            if(g.weight(e) < 0)
+                throw invalid_argument("ContractionHierarchy: negative edge weight");
+        ContractionHierarchy ch;
+        uint32_t V = static_cast<uint32_t>(g.vertexCount());
+        ch.m_vertices = V;
+        Builder b(g);
+        vector<int64_t> priority(V);
+        vector<char> contracted(V, 0);
+        priority_queue<Entry, vector<Entry>, greater<Entry>> order;
+        for(uint32_t v = 0; v < V; ++v){
+            priority[v] = b.priority(v);
+            order.push({priority[v], v});
+        }
+        while(!order.empty()){
+            Entry top = order.top();
+            order.pop();
+            uint32_t v = top.second;
+            if(contracted[v] || top.first != priority[v])
+                continue;
+            contracted[v] = 1;
+            for(uint32_t n : b.contract(v)){
+                priority[n] = b.priority(n);
+                order.push({priority[n], n});
+            }
+        }
+
+        vector<vector<Arc>>* lists[2] = {&b.up, &b.down};
+        for(int side = 0; side < 2; ++side){
+            vector<vector<Arc>>& arcs = *lists[side];
+            ch.m_offsets[side].assign(V + 1, 0);
+            for(uint32_t v = 0; v < V; ++v)
+                ch.m_offsets[side][v + 1] = ch.m_offsets[side][v] + arcs[v].size();
+            for(uint32_t v = 0; v < V; ++v)
+                for(const Arc& a : arcs[v]){
+                    ch.m_targets[side].push_back(a.to);
+                    ch.m_weights[side].push_back(a.weight);
+                }
+        }
+        ch.m_shortcuts = b.shortcuts;
+        ch.prepareQueries();
+        return ch;
+    }
+
+    // Distance from s to t, kInfDistance if t is not reachable. Throws 
+    // out_of_range if s or t is not a vertex of the hierarchy.
+    int64_t distance(uint32_t s, uint32_t t){
+        if(s >= m_vertices || t >= m_vertices)
+            throw out_of_range("ContractionHierarchy: vertex out of range");
+        if(++m_generation == 0){
+            for(int side = 0; side < 2; ++side)
+                fill(m_stamp[side].begin(), m_stamp[side].end(), 0);
+            m_generation = 1;
+        }
+        m_settled = 0;
+        uint32_t start[2] = {s, t};
+        for(int side = 0; side < 2; ++side){
+            m_heap[side].clear();
+            m_heap[side].push_back({0, start[side]});
+            m_stamp[side][start[side]] = m_generation;
+            m_dist[side][start[side]] = 0;
+        }
+        int64_t best = kInfDistance;
+        while(!m_heap[0].empty() || !m_heap[1].empty()){
+            int side = m_heap[1].empty() || (!m_heap[0].empty() && m_heap[0].front().first <= m_heap[1].front().first) ? 0 : 1;
+            vector<Entry>& heap = m_heap[side];
+            if(heap.front().first >= best){
+                heap.clear();           // nothing on this side can improve best
+                continue;
+            }
+            pop_heap(heap.begin(), heap.end(), greater<Entry>());
+            Entry top = heap.back();
+            heap.pop_back();
+            uint32_t u = top.second;
+            if(top.first != m_dist[side][u])
+                continue;
+            ++m_settled;
+            // The sums are checked against kInfDistance: weights loaded by
+            // read() are only known to be non-negative
+            if(m_stamp[1 - side][u] == m_generation && m_dist[1 - side][u] < kInfDistance - top.first)
+                best = min(best, top.first + m_dist[1 - side][u]);
+            for(uint64_t e = m_offsets[side][u]; e < m_offsets[side][u + 1]; ++e){
+                uint32_t v = m_targets[side][e];
+                if(m_weights[side][e] >= kInfDistance - top.first)
+                    continue;
+                int64_t nd = top.first + m_weights[side][e];
+                if(m_stamp[side][v] != m_generation || nd < m_dist[side][v]){
+                    m_stamp[side][v] = m_generation;
+                    m_dist[side][v] = nd;
+                    heap.push_back({nd, v});
+                    push_heap(heap.begin(), heap.end(), greater<Entry>());
+                }
+            }
+        }
+        return best;
+    }
+
+    uint64_t shortcutCount() const { return m_shortcuts; }
+    uint64_t settledCount() const { return m_settled; }
+
+    void write(ostream& out) const{
+        uint64_t header[4] = {m_vertices, m_shortcuts, m_targets[0].size(), m_targets[1].size()};
+        out.write("CHGRAPH1", 8);
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        for(int side = 0; side < 2; ++side){
+            out.write(reinterpret_cast<const char*>(m_offsets[side].data()), m_offsets[side].size() * sizeof(uint64_t));
+            out.write(reinterpret_cast<const char*>(m_targets[side].data()), m_targets[side].size() * sizeof(uint32_t));
+            out.write(reinterpret_cast<const char*>(m_weights[side].data()), m_weights[side].size() * sizeof(int64_t));
+        }
+    }
+
+    // Returns false (and leaves the hierarchy unchanged) on a bad stream: 
+    // short, offsets that are not a non-decreasing 0..count sequence, a 
+    // target that is not a vertex or a negative weight. Arrays are read 
+    // with readArray() (section 34), so a garbage count fails at end of 
+    // stream instead of allocating it.
+    bool read(istream& in){
+        char magic[8];
+        uint64_t header[4];
+        if(!in.read(magic, 8) || memcmp(magic, "CHGRAPH1", 8) != 0
+           || !in.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] > UINT32_MAX)
+            return false;
+        ContractionHierarchy loaded;
+        loaded.m_vertices = static_cast<uint32_t>(header[0]);
+        loaded.m_shortcuts = header[1];
+        for(int side = 0; side < 2; ++side){
+            const vector<uint64_t>& offsets = loaded.m_offsets[side];
+            const vector<uint32_t>& targets = loaded.m_targets[side];
+            if(!readArray(in, loaded.m_offsets[side], header[0] + 1)
+               || !readArray(in, loaded.m_targets[side], header[2 + side])
+               || !readArray(in, loaded.m_weights[side], header[2 + side])
+               || offsets.front() != 0 || offsets.back() != header[2 + side])
+                return false;
+            for(uint32_t v = 0; v < loaded.m_vertices; ++v)
+                if(offsets[v] > offsets[v + 1])
+                    return false;
+            for(uint32_t target : targets)
+                if(target >= loaded.m_vertices)
+                    return false;
+            for(int64_t weight : loaded.m_weights[side])
+                if(weight < 0)
+                    return false;
+        }
+        loaded.prepareQueries();
+        *this = move(loaded);
+        return true;
+    }
+};
+
+// Driver program: road like grid, build, save, load, query
+int main()
+{
+    const uint32_t side = 200, V = side * side;
+    mt19937 rng(21);
+    vector<WeightedEdge> edges;
+    for(uint32_t r = 0; r < side; ++r)
+        for(uint32_t c = 0; c < side; ++c){
+            uint32_t v = r * side + c;
+            // every 10th row/column is a fast "highway"
+            if(c + 1 < side) edges.push_back(WeightedEdge{v, v + 1, int32_t(r % 10 ? 20 + rng() % 40 : 5)});
+            if(r + 1 < side) edges.push_back(WeightedEdge{v, v + side, int32_t(c % 10 ? 20 + rng() % 40 : 5)});
+        }
+    CsrGraph g = CsrGraph::fromEdges(V, edges, true);
+
+    auto start = chrono::steady_clock::now();
+    ContractionHierarchy built = ContractionHierarchy::build(g);
+    chrono::duration<double, milli> ms = chrono::steady_clock::now() - start;
+    cout << "preprocessing: " << ms.count() << " ms, " << built.shortcutCount() << " shortcuts" << endl;
+
+    stringstream file;
+    built.write(file);
+    ContractionHierarchy ch;
+    start = chrono::steady_clock::now();
+    bool loaded = ch.read(file);
+    ms = chrono::steady_clock::now() - start;
+    cout << "saved " << file.str().size() << " bytes, loaded " << (loaded ? "ok" : "FAILED")
+         << " in " << ms.count() << " ms" << endl;
+
+    const int queries = 1000;
+    vector<pair<uint32_t, uint32_t>> pairs;
+    for(int i = 0; i < queries; ++i)
+        pairs.push_back({uint32_t(rng() % V), uint32_t(rng() % V)});
+    DijkstraWorkspace& ws = DijkstraWorkspace::forThisThread();
+    vector<int64_t> expected;
+    start = chrono::steady_clock::now();
+    for(auto& p : pairs)
+        expected.push_back(ws.run(g, p.first, p.second));
+    chrono::duration<double, micro> us = chrono::steady_clock::now() - start;
+    cout << "dijkstra to target (section 40): " << us.count() / queries << " us per query" << endl;
+
+    bool same = true;
+    uint64_t settled = 0;
+    start = chrono::steady_clock::now();
+    for(int i = 0; i < queries; ++i){
+        same &= ch.distance(pairs[i].first, pairs[i].second) == expected[i];
+        settled += ch.settledCount();
+    }
+    us = chrono::steady_clock::now() - start;
+    cout << "contraction hierarchy: " << us.count() / queries << " us per query, "
+         << settled / queries << " settled, " << (same ? "same" : "DIFFERENT") << " distances" << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//48. Johnson's algorithm: all pairs shortest paths for sparse graphs
+/*
+Floyd–Warshall (sections 14 and 44) is O(V^3) no matter how few edges there 
+are. V Dijkstras would be O(V E log V), much less for a sparse graph, but 
+Dijkstra is wrong with negative edges. Johnson's algorithm fixes the weights
+first:
+
+1. Add a virtual vertex q with a 0 edge to every vertex and run Bellman-Ford
+from q once (the queue mode of section 43). h[v] = d(q, v). If there is a 
+negative cycle there are no shortest paths, and Bellman-Ford returns it.
+2. Reweight: w'(u, v) = w(u, v) + h[u] - h[v]. By the triangle inequality 
+d(q, v) <= d(q, u) + w(u, v), so w' >= 0, and every u-v path changes by the 
+same h[u] - h[v], so shortest paths stay shortest.
+3. One Dijkstra per source on w', then d(u, v) = d'(u, v) - h[u] + h[v]. 
+DijkstraWorkspace of section 40 takes h as its potential and does both 
+conversions itself, so w' is never stored.
+
+The sources are independent: parallelFor() splits them over threads and 
+every thread uses its own DijkstraWorkspace::forThisThread(), so the graph 
+is shared read only and nothing is locked.
+
+Rows are not collected. run() calls onRow(source, row) with a pointer to V 
+distances as soon as a source is done and then reuses the buffer, so memory 
+is O(V) per thread instead of V^2. onRow is called from several threads at 
+once (never twice for the same source) and in no particular order; keep it 
+thread safe.
+*/
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+using namespace std;
+
+class JohnsonAllPairs{
+private:
+    const CsrGraph& m_graph;
+    unsigned m_threads;
+    bool m_prepared;
+    vector<int64_t> m_potential;
+    vector<uint32_t> m_cycle;
+public:
+    JohnsonAllPairs(const CsrGraph& g, unsigned threads = 0)
+        : m_graph(g), m_threads(threads), m_prepared(false){}
+
+    // Bellman-Ford from the virtual vertex. False if there is a negative 
+    // cycle, negativeCycle() has it then.
+    bool prepare(){
+        uint32_t V = m_graph.vertexCount();
+        vector<WeightedEdge> edges;
+        edges.reserve(m_graph.edgeCount() + V);
+        for(uint32_t u = 0; u < V; ++u)
+            for(uint64_t e = m_graph.edgesBegin(u); e < m_graph.edgesEnd(u); ++e)
+                edges.push_back(WeightedEdge{u, m_graph.target(e), m_graph.weight(e)});
+        for(uint32_t v = 0; v < V; ++v)
+            edges.push_back(WeightedEdge{V, v, 0});
+        BellmanFordEngine bellmanFord(V + 1, move(edges), m_threads);
+        bool ok = bellmanFord.run(V, BellmanFordMode::Queue);
+        m_cycle = bellmanFord.negativeCycle();
+        m_potential.assign(bellmanFord.distances().begin(), bellmanFord.distances().begin() + V);
+        m_prepared = ok;
+        return ok;
+    }
+
+    // Calls onRow(source, const int64_t* row) for every source, row[v] = 
+    // d(source, v) or kInfDistance. False (and no rows) on a negative cycle.
+    template<typename F>
+    bool run(F&& onRow){
+        if(!m_prepared && !prepare())
+            return false;
+        uint32_t V = m_graph.vertexCount();
+        parallelFor(V, m_threads, [&](size_t begin, size_t end, unsigned){
+            DijkstraWorkspace& ws = DijkstraWorkspace::forThisThread();
+            vector<int64_t> row(V);
+            for(size_t s = begin; s < end; ++s){
+                ws.run(m_graph, static_cast<uint32_t>(s), DijkstraWorkspace::kNoTarget, m_potential.data());
+                for(uint32_t v = 0; v < V; ++v)
+                    row[v] = ws.distance(v);
+                onRow(static_cast<uint32_t>(s), static_cast<const int64_t*>(row.data()));
+            }
+        });
+        return true;
+    }
+
+    const vector<int64_t>& potentials() const { return m_potential; }
+    const vector<uint32_t>& negativeCycle() const { return m_cycle; }
+};
+
+// Driver program: sparse graph with negative edges, checked against the 
+// Floyd–Warshall of section 44
+int main()
+{
+    const uint32_t V = 2048;
+    mt19937 rng(14);
+    vector<int32_t> p(V);
+    for(auto& x : p)
+        x = rng() % 500;
+    vector<WeightedEdge> edges;
+    FloydWarshall fw(V);
+    for(uint32_t i = 0; i < 4 * V; ++i){
+        uint32_t u = rng() % V, v = rng() % V;
+        int32_t w = int32_t(rng() % 1000) + p[u] - p[v];
+        if(u == v)
+            continue;
+        edges.push_back(WeightedEdge{u, v, w});
+        fw.addEdge(u, v, w);
+    }
+    CsrGraph g = CsrGraph::fromEdges(V, edges, false);
+
+    auto start = chrono::steady_clock::now();
+    fw.run();
+    chrono::duration<double, milli> ms = chrono::steady_clock::now() - start;
+    cout << "Floyd-Warshall (section 44): " << ms.count() << " ms" << endl;
+
+    JohnsonAllPairs johnson(g);
+    mutex lock;
+    uint64_t rows = 0, mismatches = 0;
+    start = chrono::steady_clock::now();
+    bool ok = johnson.run([&](uint32_t s, const int64_t* row){
+        uint64_t bad = 0;
+        for(uint32_t v = 0; v < V; ++v){
+            int64_t expected = fw.distance(s, v) == FloydWarshall::kInf ? kInfDistance : fw.distance(s, v);
+            bad += row[v] != expected;
+        }
+        lock_guard<mutex> guard(lock);
+        ++rows;
+        mismatches += bad;
+    });
+    ms = chrono::steady_clock::now() - start;
+    cout << "Johnson: " << ms.count() << " ms (including the checks), " << rows << " rows, "
+         << (ok && mismatches == 0 ? "same" : "DIFFERENT") << " distances" << endl;
+
+    // A negative cycle is reported instead of rows
+    edges.push_back(WeightedEdge{0, 1, -100000});
+    edges.push_back(WeightedEdge{1, 0, -100000});
+    CsrGraph cyclic = CsrGraph::fromEdges(V, edges, false);
+    JohnsonAllPairs broken(cyclic);
+    cout << "with a negative cycle: " << (broken.prepare() ? "no cycle" : "cycle") << ":";
+    for(uint32_t v : broken.negativeCycle())
+        cout << " " << v;
+    cout << endl;
+    return 0;
+}
+
+
+
+//*********************************************************************
+//49. Synthetic graph generators and a benchmark of the graph sections
+/*
+The examples in sections 12 - 19 have 3 to 9 vertices, which says nothing 
+about speed. Four generators cover the shapes we care about, all built on 
+the <random> engines and distributions of CPPNotes_RandomTuple.cpp (seeded,
+so every run produces the same graph):
+
+1. R-MAT (recursive matrix): each edge picks one quadrant of the adjacency 
+matrix with probabilities a, b, c, d, then a quadrant of that quadrant, and 
+so on for scale levels. With a = 0.57, b = c = 0.19 (the Graph500 values) 
+it gives a power law degree distribution like social and web graphs.
+2. Grid: rows x cols, each vertex joined to its right and lower neighbour. 
+Large diameter, degree 4, the shape of a road network.
+3. Random geometric: n points in the unit square, an edge between points 
+closer than radius, weight proportional to the distance. Points are binned 
+into cells of side >= radius (at most about n cells) so only neighbouring 
+cells are compared.
+4. Erdős–Rényi G(n, p): every pair (u < v) is an edge with probability p. 
+Instead of n^2 / 2 coin flips, a geometric_distribution gives the number of 
+pairs to skip until the next edge, so the cost is O(n + E).
+
+Weights are drawn from a uniform_int_distribution over [minWeight, 
+maxWeight] (geometric graphs use the distance instead). All generators 
+return undirected edges once each, ready for CsrGraph::fromEdges(..., true) 
+or the MST engine.
+
+The driver is the benchmark: every algorithm on every generator at a few 
+sizes, reporting time, edges per second (E / time, so the numbers of 
+different algorithms are comparable) and the peak resident set size so far 
+(getrusage, ru_maxrss is in kilobytes on Linux). The O(V^2) and O(V^3) ones 
+(Floyd–Warshall, Johnson, dense Prim) run on the small sizes only, so do 
+the transitive closure (one bit row per component: 1 GB for the ~100000 
+components of the largest R-MAT graph) and the contraction hierarchy. The 
+hierarchy is also only built for the road-like generators (grid, 
+geometric): it takes seconds on a 40000 vertex grid, but over a minute on 
+the 2048 vertex R-MAT graph and half a minute on G(n, p), whose vertices 
+keep gaining shortcuts to far away neighbours as the graph is contracted 
+(that is what section 47 is not for). The point-to-point
+rows (sections 40, 42, 47) time a batch of 100 random queries, where 
+E / time only compares them with each other. Every graph is undirected, so 
+the edge list rows (Bellman-Ford) get every edge in both directions, the 
+same graph the CSR rows see.
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+using namespace std;
+
+struct WeightRange{
+    int32_t minWeight = 1;
+    int32_t maxWeight = 100;
+};
+
+// 2^scale vertices, edgeFactor * 2^scale edges
+vector<WeightedEdge> rmatGraph(unsigned scale, unsigned edgeFactor, WeightRange weights = WeightRange(),
+                               uint64_t seed = 1, double a = 0.57, double b = 0.19, double c = 0.19)
+{
+    mt19937_64 engine(seed);
+    uniform_real_distribution<double> coin(0.0, 1.0);
+    uniform_int_distribution<int32_t> weight(weights.minWeight, weights.maxWeight);
+    size_t m = size_t(edgeFactor) << scale;
+    vector<WeightedEdge> edges;
+    edges.reserve(m);
+    for(size_t i = 0; i < m; ++i){
+        uint32_t u = 0, v = 0;
+        for(unsigned level = 0; level < scale; ++level){
+            double r = coin(engine);
+            u = u << 1 | (r >= a + b);                         // lower half: c or d
+            v = v << 1 | ((r >= a && r < a + b) || r >= a + b + c);   // right half: b or d
+        }
+        edges.push_back(WeightedEdge{u, v, weight(engine)});
+    }
+    return edges;
+}
+
+// rows * cols vertices, vertex r * cols + c
+vector<WeightedEdge> gridGraph(uint32_t rows, uint32_t cols, WeightRange weights = WeightRange(),
+                               uint64_t seed = 1)
+{
+    mt19937_64 engine(seed);
+    uniform_int_distribution<int32_t> weight(weights.minWeight, weights.maxWeight);
+    vector<WeightedEdge> edges;
+    edges.reserve(2 * size_t(rows) * cols);
+    for(uint32_t r = 0; r < rows; ++r)
+        for(uint32_t c = 0; c < cols; ++c){
+            uint32_t v = r * cols + c;
+            if(c + 1 < cols)
+                edges.push_back(WeightedEdge{v, v + 1, weight(engine)});
+            if(r + 1 < rows)
+                edges.push_back(WeightedEdge{v, v + cols, weight(engine)});
+        }
+    return edges;
+}
+
+// n points in the unit square, edges shorter than radius, weight = 
+// distance * scale (at least 1)
+vector<WeightedEdge> geometricGraph(uint32_t n, double radius, double scale = 1e6, uint64_t seed = 1)
+{
+    mt19937_64 engine(seed);
+    uniform_real_distribution<double> coordinate(0.0, 1.0);
+    vector<pair<double, double>> points(n);
+    for(auto& p : points)
+        p = {coordinate(engine), coordinate(engine)};
+    if(!(radius > 0))
+        throw invalid_argument("geometricGraph: radius must be > 0");
+    // Cells of side >= radius, so only the 3 x 3 neighbouring cells can hold
+    // a point closer than radius. More than about n cells in total only adds
+    // empty buckets (and a tiny radius would ask for billions), so larger 
+    // cells are used then, which is still correct.
+    uint32_t cells = static_cast<uint32_t>(max(1.0, min(1.0 / radius, ceil(sqrt(double(n))))));
+    auto cellOf = [&](double x){ return min(cells - 1, static_cast<uint32_t>(x * cells)); };
+    // Bucket the points by cell (counting sort)
+    vector<uint32_t> start(size_t(cells) * cells + 1, 0), order(n);
+    for(auto& p : points)
+        ++start[size_t(cellOf(p.second)) * cells + cellOf(p.first) + 1];
+    for(size_t i = 1; i < start.size(); ++i)
+        start[i] += start[i - 1];
+    vector<uint32_t> cursor(start.begin(), start.end() - 1);
+    for(uint32_t i = 0; i < n; ++i)
+        order[cursor[size_t(cellOf(points[i].second)) * cells + cellOf(points[i].first)]++] = i;
+
+    vector<WeightedEdge> edges;
+    for(uint32_t u = 0; u < n; ++u){
+        int64_t cx = cellOf(points[u].first), cy = cellOf(points[u].second);
+        for(int64_t y = max<int64_t>(0, cy - 1); y <= min<int64_t>(cells - 1, cy + 1); ++y)
+            for(int64_t x = max<int64_t>(0, cx - 1); x <= min<int64_t>(cells - 1, cx + 1); ++x)
+                for(uint32_t i = start[y * cells + x]; i < start[y * cells + x + 1]; ++i){
+                    uint32_t v = order[i];
+                    if(v <= u)
+                        continue;
+                    double d = hypot(points[u].first - points[v].first, points[u].second - points[v].second);
+                    if(d < radius)
+                        edges.push_back(WeightedEdge{u, v, max(1, int32_t(d * scale))});
+                }
+    }
+    return edges;
+}
+
+// G(n, p): every pair u < v independently with probability p
+vector<WeightedEdge> erdosRenyiGraph(uint32_t n, double p, WeightRange weights = WeightRange(),
+                                     uint64_t seed = 1)
+{
+    mt19937_64 engine(seed);
+    uniform_int_distribution<int32_t> weight(weights.minWeight, weights.maxWeight);
+    vector<WeightedEdge> edges;
+    if(p <= 0 || n < 2)
+        return edges;
+    edges.reserve(size_t(p * (double(n) * (n - 1) / 2) * 1.05));
+    // Pairs in the order (0,1) (0,2) ... (0,n-1) (1,2) ...; skip = pairs 
+    // without an edge before the next one
+    geometric_distribution<uint64_t> skip(min(p, 1.0));
+    uint32_t u = 0;
+    uint64_t v = 0;
+    while(true){
+        v += (p >= 1.0 ? 0 : skip(engine)) + 1;
+        while(u < n && v >= n){
+            v = v - n + u + 2;      // carry into the next row, which starts at u + 2
+            ++u;
+        }
+        if(u + 1 >= n)
+            break;
+        edges.push_back(WeightedEdge{u, static_cast<uint32_t>(v), weight(engine)});
+    }
+    return edges;
+}
+
+// Peak resident set size of the process so far, in MB
+double peakRssMB()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+// Driver program: the benchmark
+int main()
+{
+    cout << left << setw(11) << "graph" << right << setw(9) << "V" << setw(10) << "E" << "  "
+         << left << setw(26) << "algorithm" << right << setw(10) << "ms" << setw(12) << "Medges/s"
+         << setw(10) << "peak MB" << endl;
+    auto bench = [](const string& graph, size_t V, size_t E, const string& name, const function<void()>& body){
+        auto start = chrono::steady_clock::now();
+        body();
+        chrono::duration<double, milli> ms = chrono::steady_clock::now() - start;
+        cout << left << setw(11) << graph << right << setw(9) << V << setw(10) << E << "  "
+             << left << setw(26) << name << right << fixed << setprecision(1) << setw(10) << ms.count()
+             << setw(12) << (ms.count() > 0 ? E / ms.count() / 1000.0 : 0.0)
+             << setw(10) << peakRssMB() << endl;
+    };
+
+    for(unsigned scale : {11u, 15u, 18u}){
+        size_t V = size_t(1) << scale;
+        uint32_t side = static_cast<uint32_t>(sqrt(double(V)));
+        vector<pair<string, vector<WeightedEdge>>> graphs;
+        graphs.push_back({"rmat", rmatGraph(scale, 8)});
+        graphs.push_back({"grid", gridGraph(side, side)});
+        graphs.push_back({"geometric", geometricGraph(uint32_t(V), sqrt(8.0 / (3.14159 * V)))});
+        graphs.push_back({"erdos", erdosRenyiGraph(uint32_t(V), 8.0 / V)});
+        for(auto& entry : graphs){
+            const string& name = entry.first;
+            const vector<WeightedEdge>& edges = entry.second;
+            size_t n = name == "grid" ? size_t(side) * side : V, E = edges.size();
+            CsrGraph g;
+            bench(name, n, E, "CSR build", [&]{ g = CsrGraph::fromEdges(n, edges, true); });
+            bench(name, n, E, "dijkstra (39)", [&]{ dijkstra(g, 0); });
+            bench(name, n, E, "deltaStepping (41)", [&]{ deltaStepping(g, 0); });
+            vector<WeightedEdge> bothWays(edges);
+            for(auto& e : edges)
+                bothWays.push_back(WeightedEdge{e.dest, e.src, e.weight});
+            bench(name, n, E, "Bellman-Ford queue (43)", [&]{
+                BellmanFordEngine(n, bothWays).run(0, BellmanFordMode::Queue);
+            });
+            bench(name, n, E, "Bellman-Ford rounds (43)", [&]{
+                BellmanFordEngine(n, bothWays).run(0, BellmanFordMode::ParallelRounds);
+            });
+            mt19937 pick(scale);
+            vector<pair<uint32_t, uint32_t>> queries(100);
+            for(auto& q : queries)
+                q = {uint32_t(pick() % n), uint32_t(pick() % n)};
+            bench(name, n, E, "workspace s-t x100 (40)", [&]{
+                DijkstraWorkspace& ws = DijkstraWorkspace::forThisThread();
+                for(auto& q : queries)
+                    ws.run(g, q.first, q.second);
+            });
+            AltLandmarks landmarks;
+            bench(name, n, E, "ALT 8 landmarks (42)", [&]{ landmarks = AltLandmarks::build(g, 8); });
+            bench(name, n, E, "ALT s-t x100 (42)", [&]{
+                AltRouter router(g, landmarks);
+                for(auto& q : queries)
+                    router.query(q.first, q.second);
+            });
+            bench(name, n, E, "Kruskal radix (38)", [&]{ MstEngine().run(n, edges, MstMode::Kruskal); });
+            bench(name, n, E, "Filter-Kruskal (38)", [&]{ MstEngine().run(n, edges, MstMode::FilterKruskal); });
+            bench(name, n, E, "Boruvka (38)", [&]{ MstEngine().run(n, edges, MstMode::Boruvka); });
+            bench(name, n, E, "Prim heap (46)", [&]{ PrimEngine().run(g, PrimMode::SparseHeap); });
+            // isCycle() and hasCycle() stop at the first cycle, microseconds
+            // on these graphs, so the union find rows time full passes
+            vector<pair<uint32_t, uint32_t>> pairs;
+            for(auto& e : edges)
+                pairs.push_back({e.src, e.dest});
+            bench(name, n, E, "union find components (35)", [&]{
+                DisjointSet<> dsu(n);
+                connectedComponents(n, pairs, dsu);
+            });
+            bench(name, n, E, "parallel components (36)", [&]{ parallelConnectedComponents(n, pairs); });
+            if(scale <= 11){
+                bench(name, n, E, "Floyd-Warshall (44)", [&]{
+                    FloydWarshall fw(n);
+                    for(auto& e : edges){
+                        fw.addEdge(e.src, e.dest, e.weight);
+                        fw.addEdge(e.dest, e.src, e.weight);
+                    }
+                    fw.run();
+                });
+                bench(name, n, E, "Johnson (48)", [&]{
+                    JohnsonAllPairs(g).run([](uint32_t, const int64_t*){});
+                });
+                bench(name, n, E, "Prim dense (46)", [&]{ PrimEngine().run(n, edges, PrimMode::DenseMatrix); });
+                bench(name, n, E, "transitive closure (45)", [&]{ TransitiveClosure::build(g); });
+                if(name == "grid" || name == "geometric"){
+                    ContractionHierarchy ch;
+                    bench(name, n, E, "CH preprocessing (47)", [&]{ ch = ContractionHierarchy::build(g); });
+                    bench(name, n, E, "CH s-t x100 (47)", [&]{
+                        for(auto& q : queries)
+                            ch.distance(q.first, q.second);
+                    });
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+
+
+//*********************************************************************
+//50. Parallel edge list ingestion: mmap + SWAR text parser, binary format
+/*
+Section 13 reads "from to weight" with one scanf() per line. scanf parses 
+its format string on every call, locks the stream and handles locales, so 
+on a multi gigabyte file reading takes longer than the algorithm.
+
+Text mode (readEdgeText):
+1. mmap() the file (as in section 31) instead of copying it through read().
+2. Cut it into one chunk per thread, moving every cut forward to just after
+the next '\n', so every line belongs to exactly one chunk. Each thread parses
+its chunk into its own vector, then the vectors are copied into the result 
+in parallel at offsets given by a prefix sum.
+3. Numbers are parsed 8 bytes at a time (SWAR, "SIMD within a register"): 
+load 8 bytes into a uint64_t, xor with '0' in every byte, and find the first
+byte that is not 0-9 with a few masks and one count trailing zeros. The 
+digits are then converted with three multiplications instead of a loop of 
+multiply-adds (the digits are left aligned so that missing digits become 
+leading zeros). Fewer than 8 bytes left in the file fall back to a plain 
+loop, so the parser never reads past the mapping.
+
+Lines are "src dest [weight]" separated by spaces, tabs or commas; a missing
+weight is 1, '#' and '%' lines are comments (SNAP and Matrix Market files). 
+The vertex count is the largest id + 1. A malformed line rejects the file.
+
+Binary mode: "EDGEBIN1", the vertex and edge counts, then the WeightedEdge 
+records as they are in memory (12 bytes each). MappedEdgeFile maps it and 
+hands the records straight to CsrGraph::fromEdges(ptr, count): no parsing,
+no copy, and open() only checks the header against the file size (without
+letting count * 12 overflow), so pages are only read when the CSR builder 
+touches them. The endpoints of a stale or corrupt file are not checked 
+here: fromEdges() checks every endpoint in its degree pass and throws 
+out_of_range before writing through one. The format is native endian, so 
+it is a cache format for the machine that wrote it, not an exchange format.
+*/
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+// Number of leading ASCII digits in the 8 bytes of chunk (first byte lowest)
+inline unsigned leadingDigits(uint64_t chunk){
+    uint64_t x = chunk ^ 0x3030303030303030ULL;      // digits become 0 - 9
+    uint64_t high = x & 0xF0F0F0F0F0F0F0F0ULL;
+    uint64_t lowOver9 = ((x & 0x0F0F0F0F0F0F0F0FULL) + 0x0606060606060606ULL) & 0x1010101010101010ULL;
+    uint64_t bad = high | lowOver9;                  // non zero byte = not a digit
+    bad = (bad | bad << 1 | bad << 2 | bad << 3) & 0x8080808080808080ULL;
+    return bad ? __builtin_ctzll(bad) / 8 : 8;
+}
+
+// Value of the first count (1 - 8) digits of chunk
+inline uint32_t parseDigits(uint64_t chunk, unsigned count){
+    uint64_t v = (chunk ^ 0x3030303030303030ULL) << (8 * (8 - count));
+    v = v * 10 + (v >> 8);              // pairs of digits
+    v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+       + (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return static_cast<uint32_t>(v);
+}
+
+// Parses an optionally signed integer at p, false if there is none
+inline bool parseInteger(const char*& p, const char* end, int64_t& value){
+    bool negative = p < end && *p == '-';
+    if(negative)
+        ++p;
+    uint64_t result = 0;
+    const char* first = p;
+    while(end - p >= 8){
+        uint64_t chunk;
+        memcpy(&chunk, p, 8);
+        unsigned n = leadingDigits(chunk);
+        if(n == 0)
+            break;
+        static const uint64_t scale[9] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+        result = result * scale[n] + parseDigits(chunk, n);
+        p += n;
+        if(n < 8)
+            break;
+    }
+    if(end - p < 8)
+        for(; p < end && *p >= '0' && *p <= '9'; ++p)
+            result = result * 10 + (*p - '0');
+    if(p == first || p - first > 18)
+        return false;
+    value = negative ? -int64_t(result) : int64_t(result);
+    return true;
+}
+
+// Parses the lines of [p, end) into edges. False on a malformed line.
+inline bool parseEdgeLines(const char* p, const char* end, vector<WeightedEdge>& edges, uint32_t& maxVertex)
+{
+    auto isSeparator = [](char c){ return c == ' ' || c == '\t' || c == ',' || c == '\r'; };
+    while(p < end){
+        while(p < end && isSeparator(*p))
+            ++p;
+        if(p == end)
+            break;
+        if(*p == '\n'){
+            ++p;
+            continue;
+        }
+        if(*p == '#' || *p == '%'){
+            const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+            p = newline ? newline + 1 : end;
+            continue;
+        }
+        int64_t field[3] = {0, 0, 1};
+        int fields = 0;
+        while(fields < 3){
+            if(!parseInteger(p, end, field[fields]))
+                return false;
+            ++fields;
+            while(p < end && isSeparator(*p))
+                ++p;
+            if(p == end || *p == '\n')
+                break;
+        }
+        if(fields < 2 || (p < end && *p != '\n') || field[0] < 0 || field[1] < 0
+           || field[0] > UINT32_MAX - 1 || field[1] > UINT32_MAX - 1
+           || field[2] < INT32_MIN || field[2] > INT32_MAX)
+            return false;
+        edges.push_back(WeightedEdge{uint32_t(field[0]), uint32_t(field[1]), int32_t(field[2])});
+        maxVertex = max(maxVertex, uint32_t(max(field[0], field[1])));
+    }
+    return true;
+}
+
+struct EdgeList{
+    size_t vertices = 0;
+    vector<WeightedEdge> edges;
+};
+
+// Text edge list, parsed by threads in parallel. False if the file is 
+// missing or has a malformed line.
+bool readEdgeText(const string& path, EdgeList& result, unsigned threads = 0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        ::close(fd);
+        return false;
+    }
+    size_t length = st.st_size;
+    result = EdgeList();
+    if(length == 0){
+        ::close(fd);
+        return true;
+    }
+    void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(base == MAP_FAILED)
+        return false;
+    // Read front to back once: ask for aggressive read-ahead
+    madvise(base, length, MADV_SEQUENTIAL);
+    const char* text = static_cast<const char*>(base);
+
+    if(threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+    threads = static_cast<unsigned>(min<size_t>(threads, max<size_t>(1, length / (1 << 16))));
+    vector<size_t> cut(threads + 1, length);
+    cut[0] = 0;
+    for(unsigned t = 1; t < threads; ++t){
+        size_t at = max(cut[t - 1], length / threads * t);
+        const char* newline = static_cast<const char*>(memchr(text + at, '\n', length - at));
+        cut[t] = newline ? newline - text + 1 : length;
+    }
+
+    vector<vector<WeightedEdge>> parts(threads);
+    vector<uint32_t> maxVertex(threads, 0);
+    vector<char> ok(threads, 1);
+    parallelFor(threads, threads, [&](size_t begin, size_t end, unsigned){
+        for(size_t t = begin; t < end; ++t){
+            parts[t].reserve((cut[t + 1] - cut[t]) / 12);
+            ok[t] = parseEdgeLines(text + cut[t], text + cut[t + 1], parts[t], maxVertex[t]);
+        }
+    });
+    munmap(base, length);
+    if(find(ok.begin(), ok.end(), 0) != ok.end())
+        return false;
+
+    vector<size_t> offset(threads + 1, 0);
+    for(unsigned t = 0; t < threads; ++t)
+        offset[t + 1] = offset[t] + parts[t].size();
+    result.edges.resize(offset[threads]);
+    parallelFor(threads, threads, [&](size_t begin, size_t end, unsigned){
+        for(size_t t = begin; t < end; ++t){
+            copy(parts[t].begin(), parts[t].end(), result.edges.begin() + offset[t]);
+            vector<WeightedEdge>().swap(parts[t]);
+        }
+    });
+    if(!result.edges.empty())
+        result.vertices = size_t(*max_element(maxVertex.begin(), maxVertex.end())) + 1;
+    return true;
+}
+
+struct EdgeFileHeader{
+    char magic[8];          // "EDGEBIN1"
+    uint64_t vertices;
+    uint64_t edges;
+};
+
+bool writeEdgeBinary(const string& path, size_t V, const WeightedEdge* edges, size_t count)
+{
+    EdgeFileHeader header;
+    memcpy(header.magic, "EDGEBIN1", 8);
+    header.vertices = V;
+    header.edges = count;
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(edges), count * sizeof(WeightedEdge));
+    return static_cast<bool>(out);
+}
+
+// Read-only view of a binary edge file, the records are used in place
+class MappedEdgeFile{
+private:
+    void* m_base;
+    size_t m_length;
+    const EdgeFileHeader* m_header;
+public:
+    MappedEdgeFile(): m_base(nullptr), m_length(0), m_header(nullptr){}
+    MappedEdgeFile(const MappedEdgeFile&) = delete;
+    MappedEdgeFile& operator=(const MappedEdgeFile&) = delete;
+    ~MappedEdgeFile(){ close(); }
+
+    // Maps the file, returns false if it is missing or its header does not
+    // match its size. O(1): the records are not read, CsrGraph::fromEdges 
+    // rejects endpoints >= vertexCount() when it builds from them.
+    bool open(const string& path){
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return false;
+        struct stat st;
+        if(fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(EdgeFileHeader)){
+            ::close(fd);
+            return false;
+        }
+        m_length = st.st_size;
+        m_base = mmap(nullptr, m_length, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(m_base == MAP_FAILED){
+            m_base = nullptr;
+            return false;
+        }
+        m_header = static_cast<const EdgeFileHeader*>(m_base);
+        // Compare the count with the size by division, a huge count must 
+        // not wrap the multiplication around to the right size
+        size_t payload = m_length - sizeof(EdgeFileHeader);
+        if(memcmp(m_header->magic, "EDGEBIN1", 8) != 0 || m_header->vertices > UINT32_MAX
+           || payload % sizeof(WeightedEdge) != 0 
+           || m_header->edges != payload / sizeof(WeightedEdge)){
+            close();
+            return false;
+        }
+        madvise(m_base, m_length, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    void close(){
+        if(m_base)
+            munmap(m_base, m_length);
+        m_base = nullptr;
+        m_length = 0;
+        m_header = nullptr;
+    }
+
+    size_t vertexCount() const { return m_header ? m_header->vertices : 0; }
+    size_t edgeCount() const { return m_header ? m_header->edges : 0; }
+    const WeightedEdge* edges() const{
+        return reinterpret_cast<const WeightedEdge*>(static_cast<const char*>(m_base) + sizeof(EdgeFileHeader));
+    }
+};
+
+// Driver program: 2M edge R-MAT graph (section 49) as text and as binary
+int main()
+{
+    vector<WeightedEdge> edges = rmatGraph(18, 8, WeightRange{-1000, 1000000});
+    const string textPath = "edges_50.txt", binaryPath = "edges_50.bin";
+    {
+        FILE* out = fopen(textPath.c_str(), "w");
+        fprintf(out, "# src dest weight\n");
+        for(auto& e : edges)
+            fprintf(out, "%u %u %d\n", e.src, e.dest, e.weight);
+        fclose(out);
+    }
+
+    // The section 13 way
+    auto start = chrono::steady_clock::now();
+    vector<WeightedEdge> scanned;
+    {
+        FILE* in = fopen(textPath.c_str(), "r");
+        char comment[64];
+        if(!fgets(comment, sizeof(comment), in))
+            return 1;
+        unsigned from, next;
+        int weight;
+        while(fscanf(in, "%u%u%d", &from, &next, &weight) == 3)
+            scanned.push_back(WeightedEdge{from, next, weight});
+        fclose(in);
+    }
+    chrono::duration<double, milli> ms = chrono::steady_clock::now() - start;
+    cout << "fscanf: " << ms.count() << " ms" << endl;
+
+    EdgeList list;
+    start = chrono::steady_clock::now();
+    bool ok = readEdgeText(textPath, list);
+    ms = chrono::steady_clock::now() - start;
+    bool same = ok && list.edges.size() == scanned.size()
+             && equal(scanned.begin(), scanned.end(), list.edges.begin(), [](const WeightedEdge& a, const WeightedEdge& b){
+                    return a.src == b.src && a.dest == b.dest && a.weight == b.weight;
+                });
+    cout << "readEdgeText: " << ms.count() << " ms, " << list.edges.size() << " edges, "
+         << list.vertices << " vertices, " << (same ? "same" : "DIFFERENT") << " edges" << endl;
+
+    writeEdgeBinary(binaryPath, size_t(1) << 18, edges.data(), edges.size());
+    start = chrono::steady_clock::now();
+    MappedEdgeFile file;
+    ok = file.open(binaryPath);
+    if(!ok){
+        cout << "cannot map " << binaryPath << endl;
+        return 1;
+    }
+    CsrGraph fromBinary = CsrGraph::fromEdges(file.vertexCount(), file.edges(), file.edgeCount(), false);
+    ms = chrono::steady_clock::now() - start;
+    cout << "binary -> CSR: " << ms.count() << " ms" << endl;
+
+    start = chrono::steady_clock::now();
+    readEdgeText(textPath, list);
+    CsrGraph fromText = CsrGraph::fromEdges(size_t(1) << 18, list.edges, false);
+    ms = chrono::steady_clock::now() - start;
+    cout << "text -> CSR: " << ms.count() << " ms" << endl;
+
+    bool sameGraph = ok && fromBinary.edgeCount() == fromText.edgeCount();
+    for(uint64_t e = 0; sameGraph && e < fromText.edgeCount(); ++e)
+        sameGraph = fromBinary.target(e) == fromText.target(e) && fromBinary.weight(e) == fromText.weight(e);
+    cout << "graphs " << (sameGraph ? "match" : "DIFFER") << endl;
+
+    // Malformed input is rejected, not half read
+    {
+        FILE* out = fopen(textPath.c_str(), "w");
+        fprintf(out, "1 2 3\n4 x 6\n");
+        fclose(out);
+    }
+    cout << "malformed file " << (readEdgeText(textPath, list) ? "ACCEPTED" : "rejected") << endl;
+    // A binary file with an endpoint past its vertex count maps fine, the 
+    // builder is what refuses it
+    WeightedEdge corrupt = {0, 5, 1};
+    writeEdgeBinary(binaryPath, 2, &corrupt, 1);
+    try{
+        if(file.open(binaryPath))
+            CsrGraph::fromEdges(file.vertexCount(), file.edges(), file.edgeCount(), false);
+        cout << "corrupt binary file ACCEPTED" << endl;
+    }catch(const out_of_range& e){
+        cout << "corrupt binary file rejected: " << e.what() << endl;
+    }
+    file.close();
+    remove(textPath.c_str());
+    remove(binaryPath.c_str());
+    return 0;
+}